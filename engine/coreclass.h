@@ -1,3 +1,4 @@
 #include "tile/tile_oclass.h"
+#include "tile/tilemap_oclass.h"
 #include "scene/scene_oclass.h"
 #include "render/camera_oclass.h"
\ No newline at end of file
@@ -24,6 +24,8 @@ void Engine::Init(const char* cfgPath) {
                 tile_width = root.get("tile_width", tile_width).asInt();
                 tile_height = root.get("tile_height", tile_height).asInt();
                 atlas_size = root.get("atlas_size", atlas_size).asInt();
+                texture_budget_mb = root.get("texture_budget_mb", texture_budget_mb).asInt();
+                render_thread = root.get("render_thread", render_thread).asBool();
                 // scene folder where .fscn files live
                 scene_folder = root.get("scene_folder", scene_folder).asString();
             }
@@ -97,6 +99,15 @@ void Engine::Init(const char* cfgPath) {
         if (!sceneMgr) {
             this->sceneMgr = new sceneManager(scene_folder);
         }
+        if (!events) {
+            this->events = new EventBus(objMgr);
+        }
+        if (!timers) {
+            this->timers = new TimerService(objMgr);
+        }
+        if (!behaviours) {
+            this->behaviours = new BehaviourRunner(objMgr, timers, events);
+        }
         if (!rPipeline){
             stbi_set_flip_vertically_on_load(true);
             this->rPipeline = new renderPipeline(this);
@@ -108,6 +119,8 @@ void Engine::Init(const char* cfgPath) {
             // Prefer local fonts managed by the addon; let discovery pick one if unspecified
             guilptr->setFont("", 24);
             guilptr->addText("Hello, UI Layer!");
+            // last: GL setup above ran with the context current here
+            if (render_thread) rPipeline->startRenderThread();
         }
         if (!mLnr){
             this->mLnr = new mListener();}
@@ -161,20 +174,39 @@ void Engine::update() {
         fpsTimerStart = now;
     }
 
+    // fire timers that came due since the last frame
+    if (timers) timers->advance(deltaTime);
+
     for (auto& obj : objMgr->registry){
         obj->UpdateDelta(deltaTime);
 
         if (!obj->getParent()) continue; // root or detached object
         
-        obj->x = obj->getParent()->x + obj->lx;
-        obj->y = obj->getParent()->y + obj->ly;
-        obj->z = obj->getParent()->z + obj->lz;
+        const Object* parent = obj->getParent();
+        float nx = parent->x + obj->lx, ny = parent->y + obj->ly, nz = parent->z + obj->lz;
+        if (nx == obj->x && ny == obj->y && nz == obj->z) continue;
+        obj->x = nx;
+        obj->y = ny;
+        obj->z = nz;
+        obj->markChanged(Object::CHANGED_MOVED);
     }
+    // deliver events raised by objects this frame
+    if (events) events->dispatch();
+    // resume behaviours woken by the frame, timers or those events
+    if (behaviours) behaviours->run();
     // tick input listeners so "hold" handlers are invoked each frame
     if (mLnr) mLnr->tick();
     if (kLnr) kLnr->tick();
 
     Update();
+    // and those raised by input handlers / game logic
+    if (events) events->dispatch();
+
+    // publish this frame's moved/spawned/destroyed/retextured sets for render & other systems
+    objMgr->commitChanges();
+    if (events) events->forgetObjects(objMgr->getChanges().destroyed);
+    if (timers) timers->cancelOwners(objMgr->getChanges().destroyed);
+    if (behaviours) behaviours->stopOwners(objMgr->getChanges().destroyed);
 }
 
 void Engine::render() {
@@ -204,6 +236,19 @@ void Engine::clean() {
         delete sceneMgr;
         sceneMgr = nullptr;
     }
+    // behaviours first: stopping them releases their timers and subscriptions
+    if (behaviours) {
+        delete behaviours;
+        behaviours = nullptr;
+    }
+    if (events) {
+        delete events;
+        events = nullptr;
+    }
+    if (timers) {
+        delete timers;
+        timers = nullptr;
+    }
 
     SDL_DestroyWindow(window);
     SDL_GL_DeleteContext(glContext);
@@ -16,6 +16,9 @@
 #include "engine/input/mouse.h"
 #include "engine/input/keyboard.h"
 #include "engine/scene/serialise.h" 
+#include "engine/event/event_bus.h"
+#include "engine/timer/timer_service.h"
+#include "engine/script/behaviour.h"
 #include <json/json.h>
 #include <iostream>
 #include <fstream>
@@ -46,6 +49,11 @@ public:
 
     // Atlas size used by the renderer (square)
     int atlas_size = 2048;
+    // Atlas bytes the world layer keeps for images nothing uses before evicting them (0: no limit)
+    int texture_budget_mb = 256;
+    // Submit GL work from a render thread that owns the context (frame N+1 is simulated
+    // while frame N is drawn); off: everything stays on the main thread
+    bool render_thread = false;
 
     // Where textual scene files live (folder relative to game/)
     std::string scene_folder = "demo/scn";
@@ -63,6 +71,7 @@ public:
  */
     bool running() { return isRunning; }
     SDL_Window* getWindow() { return window; }
+    SDL_GLContext getGLContext() { return glContext; }
     
     objManager* objMgr = nullptr; 
     renderPipeline* rPipeline = nullptr; 
@@ -72,6 +81,15 @@ public:
     // Scene manager for loading/unloading textual scenes
     sceneManager* sceneMgr = nullptr;
 
+    // Batched object messaging; dispatched after object updates and after Update()
+    EventBus* events = nullptr;
+
+    // One-shot / repeating timers, advanced by update() before objects run
+    TimerService* timers = nullptr;
+
+    // Coroutine behaviours, resumed once per update after object updates
+    BehaviourRunner* behaviours = nullptr;
+
     
     int sdl_sx, sdl_sy;
     // logical (virtual) render resolution used for layout and projection (set from config)
@@ -0,0 +1,52 @@
+#include "engine/event/event_bus.h"
+#include "engine/obj/obj_mgr.h"
+
+void EventBus::unsubscribe(HandlerId id) {
+    uint32_t idx = uint32_t(id >> 32);
+    if (idx >= channels.size() || !channels[idx]) return;
+    channels[idx]->remove(uint32_t(id));
+}
+
+void EventBus::dispatch() {
+    // channels are indexed by type, so each type's batch is delivered contiguously
+    for (size_t i = 0; i < channels.size(); ++i) {
+        if (channels[i]) channels[i]->dispatch(*this);
+    }
+}
+
+void EventBus::forgetObjects(const std::vector<int>& ids) {
+    if (ids.empty()) return;
+    for (auto &ch : channels) {
+        if (!ch) continue;
+        for (int id : ids) ch->forgetObject(id);
+    }
+}
+
+size_t EventBus::pendingCount() const {
+    size_t n = 0;
+    for (auto &ch : channels) if (ch) n += ch->pending();
+    return n;
+}
+
+void EventBus::clear() {
+    for (auto &ch : channels) if (ch) ch->clear();
+}
+
+Object* EventBus::resolve(int targetId, bool& dropped) const {
+    dropped = false;
+    if (targetId == 0) return nullptr;
+    Object* obj = objMgr ? objMgr->findById(targetId) : nullptr;
+    if (!obj) dropped = true; // target destroyed before delivery
+    return obj;
+}
+
+bool EventBus::classMatches(const Object* obj, const std::string& cls) {
+    // "class" or "class.subclass"
+    const std::string &c = obj->obj_class;
+    if (cls.size() == c.size()) return cls == c;
+    const std::string &s = obj->obj_subclass;
+    return cls.size() == c.size() + 1 + s.size()
+        && cls.compare(0, c.size(), c) == 0
+        && cls[c.size()] == '.'
+        && cls.compare(c.size() + 1, s.size(), s) == 0;
+}
@@ -0,0 +1,251 @@
+#ifndef EVENT_BUS_H
+#define EVENT_BUS_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "engine/obj/obj.h"
+
+class objManager;
+
+// Typed, batched event bus for object-to-object messaging.
+//
+// Any copyable struct can be an event type. Producers `emit` during update and the
+// event is only queued; the engine calls dispatch() at fixed points in Engine::update,
+// which delivers each type's queued events as one batch (types in registration order,
+// events of a type in emission order). Events emitted by handlers join a later batch
+// (a later type in the same dispatch, or the next dispatch), so delivery never recurses.
+//
+// An event may be addressed to an object id (0 = untargeted). Handlers receive the
+// resolved target (nullptr if untargeted); events whose target was destroyed before
+// dispatch are dropped. Subscriptions can listen to:
+//   subscribe<E>(fn)               every event of type E
+//   subscribeObject<E>(id, fn)     events of type E addressed to object `id`
+//   subscribeClass<E>(cls, fn)     events addressed to any object of class `cls`
+//                                  (or "class.subclass" for one subclass)
+//
+//   struct Damage { int amount; };
+//   engine->events->subscribeClass<Damage>("player", [](const Damage& d, Object* who){ ... });
+//   engine->events->emit(Damage{5}, bob);
+class EventBus {
+public:
+    using HandlerId = uint64_t; // (type index << 32) | serial; 0 is never issued
+
+    template <typename E>
+    using Handler = std::function<void(const E&, Object*)>;
+
+    explicit EventBus(objManager* mgr) : objMgr(mgr) {}
+
+    template <typename E>
+    void emit(const E& ev, int targetId = 0) {
+        channel<E>().queue.push_back(Queued<E>{ev, targetId});
+    }
+    template <typename E>
+    void emit(const E& ev, const Object* target);
+
+    template <typename E>
+    HandlerId subscribe(Handler<E> fn) {
+        return channel<E>().add(Channel<E>::ALL, 0, std::string(), std::move(fn));
+    }
+    template <typename E>
+    HandlerId subscribeObject(int objId, Handler<E> fn) {
+        return channel<E>().add(Channel<E>::OBJECT, objId, std::string(), std::move(fn));
+    }
+    template <typename E>
+    HandlerId subscribeClass(const std::string& cls, Handler<E> fn) {
+        return channel<E>().add(Channel<E>::CLASS, 0, cls, std::move(fn));
+    }
+
+    // Safe to call from inside a handler
+    void unsubscribe(HandlerId id);
+
+    // Deliver everything queued so far, one type at a time
+    void dispatch();
+
+    // Drop per-object subscriptions (called with the frame's destroyed ids)
+    void forgetObjects(const std::vector<int>& ids);
+
+    size_t pendingCount() const;
+    void clear(); // drop queued events (subscriptions are kept)
+
+private:
+    template <typename E>
+    struct Queued {
+        E ev;
+        int target;
+    };
+
+    struct ChannelBase {
+        virtual ~ChannelBase() = default;
+        virtual void dispatch(EventBus& bus) = 0;
+        virtual void remove(uint32_t serial) = 0;
+        virtual void forgetObject(int objId) = 0;
+        virtual size_t pending() const = 0;
+        virtual void clear() = 0;
+    };
+
+    template <typename E>
+    struct Channel : ChannelBase {
+        enum Kind { ALL, OBJECT, CLASS };
+        struct Sub {
+            uint32_t serial;
+            Handler<E> fn;
+            bool alive = true; // cleared on unsubscribe; fn is kept until compact() as it may be running
+        };
+
+        uint32_t typeIndex = 0;
+        uint32_t nextSerial = 1;
+        std::vector<Queued<E>> queue; // filled by emit
+        std::vector<Queued<E>> batch; // being delivered
+        std::vector<Sub> all;
+        std::unordered_map<int, std::vector<Sub>> byObject;
+        std::unordered_map<std::string, std::vector<Sub>> byClass;
+
+        // subscriptions made while delivering are applied after the batch
+        bool delivering = false;
+        struct Deferred { Kind kind; int objId; std::string cls; Sub sub; };
+        std::vector<Deferred> deferred;
+        size_t dead = 0;
+
+        HandlerId add(Kind kind, int objId, const std::string& cls, Handler<E> fn) {
+            if (!fn) return 0;
+            Sub sub{nextSerial++, std::move(fn), true};
+            HandlerId id = (HandlerId(typeIndex) << 32) | sub.serial;
+            if (delivering) deferred.push_back(Deferred{kind, objId, cls, std::move(sub)});
+            else insert(kind, objId, cls, std::move(sub));
+            return id;
+        }
+
+        void insert(Kind kind, int objId, const std::string& cls, Sub&& sub) {
+            if (kind == ALL) all.push_back(std::move(sub));
+            else if (kind == OBJECT) byObject[objId].push_back(std::move(sub));
+            else byClass[cls].push_back(std::move(sub));
+        }
+
+        static void call(std::vector<Sub>& subs, const E& ev, Object* target) {
+            // index loop + size snapshot: handlers may unsubscribe (which only clears alive)
+            for (size_t i = 0, n = subs.size(); i < n; ++i) {
+                if (subs[i].alive) subs[i].fn(ev, target);
+            }
+        }
+
+        void dispatch(EventBus& bus) override;
+
+        void remove(uint32_t serial) override {
+            auto kill = [&](std::vector<Sub>& subs) {
+                for (auto& s : subs) {
+                    if (s.serial == serial && s.alive) { s.alive = false; ++dead; return true; }
+                }
+                return false;
+            };
+            for (auto it = deferred.begin(); it != deferred.end(); ++it) {
+                if (it->sub.serial == serial) { deferred.erase(it); return; }
+            }
+            if (kill(all)) return;
+            for (auto& p : byObject) if (kill(p.second)) return;
+            for (auto& p : byClass) if (kill(p.second)) return;
+        }
+
+        void compact() {
+            auto sweep = [](std::vector<Sub>& subs) {
+                subs.erase(std::remove_if(subs.begin(), subs.end(), [](const Sub& s){ return !s.alive; }), subs.end());
+            };
+            sweep(all);
+            for (auto it = byObject.begin(); it != byObject.end();) {
+                sweep(it->second);
+                it = it->second.empty() ? byObject.erase(it) : std::next(it);
+            }
+            for (auto it = byClass.begin(); it != byClass.end();) {
+                sweep(it->second);
+                it = it->second.empty() ? byClass.erase(it) : std::next(it);
+            }
+            dead = 0;
+        }
+
+        void forgetObject(int objId) override {
+            auto it = byObject.find(objId);
+            if (it == byObject.end()) return;
+            if (delivering) {
+                for (auto& s : it->second) if (s.alive) { s.alive = false; ++dead; }
+            } else {
+                byObject.erase(it);
+            }
+        }
+
+        size_t pending() const override { return queue.size(); }
+        void clear() override { queue.clear(); }
+    };
+
+    template <typename E>
+    static uint32_t typeIndexOf() {
+        static const uint32_t idx = nextTypeIndex++;
+        return idx;
+    }
+
+    template <typename E>
+    Channel<E>& channel() {
+        uint32_t idx = typeIndexOf<E>();
+        if (idx >= channels.size()) channels.resize(idx + 1);
+        if (!channels[idx]) {
+            auto ch = std::make_unique<Channel<E>>();
+            ch->typeIndex = idx;
+            channels[idx] = std::move(ch);
+        }
+        return static_cast<Channel<E>&>(*channels[idx]);
+    }
+
+    Object* resolve(int targetId, bool& dropped) const;
+    static bool classMatches(const Object* obj, const std::string& cls);
+
+    static inline uint32_t nextTypeIndex = 1;
+
+    objManager* objMgr = nullptr;
+    std::vector<std::unique_ptr<ChannelBase>> channels; // indexed by type index
+};
+
+// -----------------------------
+// template definitions
+
+template <typename E>
+void EventBus::emit(const E& ev, const Object* target) {
+    emit(ev, target ? target->id : 0);
+}
+
+template <typename E>
+void EventBus::Channel<E>::dispatch(EventBus& bus) {
+    if (queue.empty()) {
+        if (dead) compact();
+        return;
+    }
+    batch.clear();
+    batch.swap(queue); // emits during delivery queue up for the next batch
+    delivering = true;
+    for (const auto& q : batch) {
+        bool dropped = false;
+        Object* target = bus.resolve(q.target, dropped);
+        if (dropped) continue;
+        call(all, q.ev, target);
+        if (!target) continue;
+        if (!byObject.empty()) {
+            auto it = byObject.find(q.target);
+            if (it != byObject.end()) call(it->second, q.ev, target);
+        }
+        for (auto& p : byClass) {
+            if (classMatches(target, p.first)) call(p.second, q.ev, target);
+        }
+    }
+    delivering = false;
+    batch.clear();
+    for (auto& d : deferred) insert(d.kind, d.objId, d.cls, std::move(d.sub));
+    deferred.clear();
+    if (dead) compact();
+}
+
+#endif // EVENT_BUS_H
@@ -2,6 +2,7 @@
 #include "ft2gl.h"
 #include "engine/render/renderm.h"
 #include "engine/obj/ui_text_oclass.h"
+#include <cmath>
 #include <iostream>
 #include <unordered_map>
 #include <cstring>
@@ -58,7 +59,7 @@ void GuiLayer::prepare(renderPipeline* pipeline) {
             glyphCache[key] = glyph;
 
             // Use the key string as the image path so atlas maps contain it
-            rawImages[key] = ri;
+            addRawImage(key, ri);
             renderedGlyphs.insert(key);
         }
     }
@@ -128,7 +129,7 @@ void GuiLayer::render(renderPipeline* pipeline) {
             ri.pixels = (unsigned char*)malloc(size_t(ri.w) * size_t(ri.h) * 4);
             memcpy(ri.pixels, glyph.pixels.data(), size_t(ri.w) * size_t(ri.h) * 4);
             glyphCache[key] = glyph;
-            rawImages[key] = ri;
+            addRawImage(key, ri);
             addedGlyphs = true;
         }
 
@@ -179,15 +180,16 @@ void GuiLayer::render(renderPipeline* pipeline) {
         }
     }
 
-    if (addedAny) {
-        std::cout << "GuiLayer: added glyphs at render time, rebuilding atlas\n";
-        RenderLayer::rebuildAtlas();
-    } else {
-        RenderLayer::prepare(pipeline);
-    }
+    // new glyphs go into free atlas space (a full repack only if they don't fit). Not a
+    // second prepare(): this frame's earlier uploads still need their CPU copies
+    if (addedAny) std::cout << "GuiLayer: added glyphs at render time, inserting into atlas\n";
+    updateAtlas(pipeline);
 
-    // Build vertices for all UI entries and object-derived UI texts
-    std::vector<float> verts;
+    // Build vertices for all UI entries and object-derived UI texts: four compact
+    // vertices per glyph, in virtual pixels (default.vs maps them to NDC)
+    std::vector<QuadVertex> verts;
+    auto unorm16 = [](float v) { return uint16_t(std::min(std::max(v, 0.0f), 1.0f) * 65535.0f + 0.5f); };
+    auto pixel = [](int v) { return int16_t(std::min(std::max(v, -32768), 32767)); };
 
     auto appendTextVerts = [&](const std::string &font, int size, const std::string &text, int startX, int startY) {
         int x = startX;
@@ -201,24 +203,22 @@ void GuiLayer::render(renderPipeline* pipeline) {
             int gw = ri.w, gh = ri.h;
             GlyphBitmap g = glyphCache[key];
 
-            int x0px = x + g.left;
-            int y0px = baseline - g.top;
-            int x1px = x0px + gw;
-            int y1px = y0px + gh;
-            float z = -0.00001f;
-
-            float x0 = pipeline->screenToNDCx(x0px);
-            float y0 = pipeline->screenToNDCy(y0px);
-            float x1 = pipeline->screenToNDCx(x1px);
-            float y1 = pipeline->screenToNDCy(y1px);
+            // the atlas keeps the glyph's trimmed box; place the quad over just that part
+            int left = x + g.left, top = baseline - g.top;
+            int x0px = left + int(std::lround(uv.x0 * gw));
+            int y0px = top + int(std::lround(uv.y0 * gh));
+            int x1px = left + int(std::lround(uv.x1 * gw));
+            int y1px = top + int(std::lround(uv.y1 * gh));
 
-            verts.push_back(x0); verts.push_back(y0); verts.push_back(z); verts.push_back(0.0f); verts.push_back(0.0f); verts.push_back(1.0f); verts.push_back(uv.u0); verts.push_back(uv.v0);
-            verts.push_back(x1); verts.push_back(y0); verts.push_back(z); verts.push_back(0.0f); verts.push_back(0.0f); verts.push_back(1.0f); verts.push_back(uv.u1); verts.push_back(uv.v0);
-            verts.push_back(x1); verts.push_back(y1); verts.push_back(z); verts.push_back(0.0f); verts.push_back(0.0f); verts.push_back(1.0f); verts.push_back(uv.u1); verts.push_back(uv.v1);
+            int16_t x0 = pixel(x0px), y0 = pixel(y0px), x1 = pixel(x1px), y1 = pixel(y1px);
+            uint16_t u0 = unorm16(uv.u0), v0 = unorm16(uv.v0), u1 = unorm16(uv.u1), v1 = unorm16(uv.v1);
+            const uint32_t WHITE = 0xFFFFFFFFu, page = uint32_t(uv.page);
 
-            verts.push_back(x1); verts.push_back(y1); verts.push_back(z); verts.push_back(0.0f); verts.push_back(0.0f); verts.push_back(1.0f); verts.push_back(uv.u1); verts.push_back(uv.v1);
-            verts.push_back(x0); verts.push_back(y1); verts.push_back(z); verts.push_back(0.0f); verts.push_back(0.0f); verts.push_back(1.0f); verts.push_back(uv.u0); verts.push_back(uv.v1);
-            verts.push_back(x0); verts.push_back(y0); verts.push_back(z); verts.push_back(0.0f); verts.push_back(0.0f); verts.push_back(1.0f); verts.push_back(uv.u0); verts.push_back(uv.v0);
+            // corners in quad index order: two triangles (0 1 2) and (2 3 0)
+            verts.push_back(QuadVertex{x0, y0, u0, v0, WHITE, page});
+            verts.push_back(QuadVertex{x1, y0, u1, v0, WHITE, page});
+            verts.push_back(QuadVertex{x1, y1, u1, v1, WHITE, page});
+            verts.push_back(QuadVertex{x0, y1, u0, v1, WHITE, page});
 
             if (g.advance > 0) x += g.advance; else x += gw + 2;
         }
@@ -259,11 +259,10 @@ void GuiLayer::render(renderPipeline* pipeline) {
     }
 
     if (!verts.empty()) {
-        int glyphCount = int(verts.size() / (6 * 8));
         // Draw UI on top: disable depth test so UI is always visible
-        glDisable(GL_DEPTH_TEST);
-        drawVerts(pipeline, verts, atlasTex);
-        glEnable(GL_DEPTH_TEST);
+        gl([] { glState::enable(GL_DEPTH_TEST, false); });
+        drawQuads(pipeline, verts);
+        gl([] { glState::enable(GL_DEPTH_TEST, true); });
     }
 
     // Clear transient UI entries (remove only non-persistent)
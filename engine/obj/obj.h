@@ -7,6 +7,8 @@
     #include <json/json.h>
     #include <unordered_map>
     #include <functional>
+    #include <vector>
+    #include <cstdint>
 
     class objManager; // forward declaration
 
@@ -21,12 +23,17 @@
         std::string objName;
         bool invis = false;
         bool manualTex = false;
+        // hint for the renderer: the object never moves or changes texture, so it is
+        // drawn from retained geometry from the start (see IsometricLayer)
+        bool isStatic = false;
 
         Object() {
+            properties.reserve(4);
             // allow prototypes to opt-out of automatic texture resolution
             registerBoolProperty("manualTex", manualTex);
             // allow prototypes to directly set the resolved texture path when manual mode is enabled
             registerStringProperty("texture", texture);
+            registerBoolProperty("static", isStatic);
         }
 
         std::vector<Object*>& getChildren()  { return children; }
@@ -43,6 +50,21 @@
         float lz = 0.0f;
         int id = 0;
 
+        // Last transform committed by objManager change tracking
+        float trackedX = 0.0f;
+        float trackedY = 0.0f;
+        float trackedZ = 0.0f;
+
+        // Changes queued for the next objManager::commitChanges(); 0 when not queued
+        enum : uint8_t { CHANGED_MOVED = 1, CHANGED_TEXTURE = 2 };
+        uint8_t changedBits = 0;
+        objManager* owner = nullptr; // manager tracking this object, set when it spawns
+
+        // Spatial grid cell currently holding this object (objManager::grid)
+        int gridCX = 0;
+        int gridCY = 0;
+        bool inGrid = false;
+
         // Describe for debug
         virtual void describe() const {
             if (id != 0){
@@ -61,27 +83,49 @@
         
         virtual void resolveTexture(const objManager& mgr);
         virtual void setTex(const std::string& newRef, const objManager& mgr);
+        void setInvis(bool v) { if (invis == v) return; invis = v; markChanged(CHANGED_TEXTURE); }
+
+        // Queue a change for the next commit. Engine::update does this when it moves an
+        // object, setTex/setInvis when they change it; code that assigns texture or invis
+        // directly has to call markChanged(CHANGED_TEXTURE) itself.
+        void markChanged(uint8_t bits);
         // Property system: derived classes can register named property setters
         // that are invoked when a prototype's properties block is applied.
         using PropertySetter = std::function<void(const Json::Value&)>;
 
+        // Typed view of a registered property so snapshots can read values back.
+        // Properties registered with a bare setter are Custom and are not snapshotted.
+        enum class PropType : uint8_t { Custom, Float, Int, Bool, String };
+        struct Property {
+            std::string name;
+            PropertySetter setter;
+            PropType type = PropType::Custom;
+            void* ref = nullptr;
+        };
+
         // Register a generic setter (usually called from derived class ctor)
         void registerProperty(const std::string& name, PropertySetter setter) {
-            propertySetters[name] = std::move(setter);
+            addProperty(name, std::move(setter), PropType::Custom, nullptr);
         }
 
         // Convenience helpers to register common member types by reference
         void registerFloatProperty(const std::string& name, float &ref) {
-            propertySetters[name] = [&ref](const Json::Value &v){ if (!v.isNull()) ref = v.asFloat(); };
+            addProperty(name, [&ref](const Json::Value &v){ if (!v.isNull()) ref = v.asFloat(); }, PropType::Float, &ref);
         }
         void registerIntProperty(const std::string& name, int &ref) {
-            propertySetters[name] = [&ref](const Json::Value &v){ if (!v.isNull()) ref = v.asInt(); };
+            addProperty(name, [&ref](const Json::Value &v){ if (!v.isNull()) ref = v.asInt(); }, PropType::Int, &ref);
         }
         void registerBoolProperty(const std::string& name, bool &ref) {
-            propertySetters[name] = [&ref](const Json::Value &v){ if (!v.isNull()) ref = v.asBool(); };
+            addProperty(name, [&ref](const Json::Value &v){ if (!v.isNull()) ref = v.asBool(); }, PropType::Bool, &ref);
         }
         void registerStringProperty(const std::string& name, std::string &ref) {
-            propertySetters[name] = [&ref](const Json::Value &v){ if (!v.isNull()) ref = v.asString(); };
+            addProperty(name, [&ref](const Json::Value &v){ if (!v.isNull()) ref = v.asString(); }, PropType::String, &ref);
+        }
+
+        const std::vector<Property>& getProperties() const { return properties; }
+        Property* findProperty(const std::string& name) {
+            for (auto &p : properties) if (p.name == name) return &p;
+            return nullptr;
         }
 
         // Apply properties: iterate JSON keys and invoke any registered setters.
@@ -89,9 +133,8 @@
         virtual void applyProperties(const Json::Value& props) {
             if (!props || props.isNull()) return;
             for (const auto &name : props.getMemberNames()) {
-                auto it = propertySetters.find(name);
-                if (it != propertySetters.end()) {
-                    it->second(props[name]);
+                if (Property* p = findProperty(name)) {
+                    p->setter(props[name]);
                 } else {
                     // unknown property: ignore silently (or log if desired)
                 }
@@ -100,8 +143,25 @@
         virtual void Update(){}
         // Delta-aware update: default implementation calls legacy Update().
         virtual void UpdateDelta(float dt) { Update(); }
+
+        // Class-specific state that is not covered by registered properties (bulk data).
+        // Used by binary snapshots; default objects have nothing extra to store.
+        virtual void saveState(std::vector<unsigned char>& /*out*/) const {}
+        virtual void loadState(const unsigned char* /*data*/, size_t /*size*/) {}
     private:
-        std::unordered_map<std::string, PropertySetter> propertySetters;
+        // Registered properties. A small vector rather than a map: objects register a
+        // handful of properties and construction cost matters for bulk instantiation.
+        std::vector<Property> properties;
+
+        void addProperty(const std::string& name, PropertySetter setter, PropType type, void* ref) {
+            if (Property* p = findProperty(name)) {
+                p->setter = std::move(setter);
+                p->type = type;
+                p->ref = ref;
+                return;
+            }
+            properties.push_back(Property{name, std::move(setter), type, ref});
+        }
 
         std::vector<Object*> children; // raw pointers
         Object* parent = nullptr;
@@ -29,6 +29,12 @@ public:
         return nullptr;
     }
 
+    // Look up a creator once so bulk instantiation can skip the per-object name lookup
+    static const Creator* getCreator(const std::string& name) {
+        auto it = getRegistry().find(name);
+        return it != getRegistry().end() ? &it->second : nullptr;
+    }
+
 private:
     static std::unordered_map<std::string, Creator>& getRegistry() {
         static std::unordered_map<std::string, Creator> registry;
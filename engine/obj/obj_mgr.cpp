@@ -1,6 +1,7 @@
 #include "engine/obj/obj_mgr.h"
 #include <fstream>
 #include <iostream>
+#include <unordered_set>
 #include "engine/coreclass.h"
 
 int counter = 1;
@@ -37,36 +38,43 @@ void Object::resolveTexture(const objManager& mgr) {
     // If manual mode is enabled, do not attempt to resolve from prototypes
     if (manualTex) return;
 
-    // find this object's texture mapping from JSON based on texref name
-    for (const auto& data : mgr.objectDefs) {
+    if (mgr.findPrototypeTexture(obj_class, obj_subclass, texref, texture)) return;
+
+    std::cerr << "resolveTexture: failed to find texture for "
+              << obj_class << ":" << obj_subclass
+              << " texref=" << texref << "\n";
+}
+
+bool objManager::findPrototypeTexture(const std::string& obj_class, const std::string& obj_subclass,
+                                      const std::string& texref, std::string& out) const {
+    // find the texture mapping from JSON based on texref name
+    for (const auto& data : objectDefs) {
         if (data.obj_class == obj_class && data.obj_subclass == obj_subclass) {
             const Json::Value &textures = data.textures;
             if (textures.isObject()) {
                 // prefer explicit texref name
                 if (!texref.empty() && textures.isMember(texref)) {
-                    texture = textures[texref].asString();
-                    return;
+                    out = textures[texref].asString();
+                    return true;
                 }
                 // fall back to default
                 if (textures.isMember("default")) {
-                    texture = textures["default"].asString();
-                    return;
+                    out = textures["default"].asString();
+                    return true;
                 }
             } else if (textures.isString()) {
                 // backward compatible: single default string
-                texture = textures.asString();
-                return;
+                out = textures.asString();
+                return true;
             }
             break;
         }
     }
-
-    std::cerr << "resolveTexture: failed to find texture for "
-              << obj_class << ":" << obj_subclass
-              << " texref=" << texref << "\n";
+    return false;
 }
 
 void Object::setTex(const std::string& newRef, const objManager& mgr) {
+    std::string before = texture;
     if (manualTex) {
         // caller provided actual texture path when in manual mode
         texture = newRef;
@@ -75,6 +83,13 @@ void Object::setTex(const std::string& newRef, const objManager& mgr) {
         texref = newRef;
         resolveTexture(mgr);
     }
+    if (texture != before) markChanged(CHANGED_TEXTURE);
+}
+
+void Object::markChanged(uint8_t bits) {
+    if (!owner) return; // not spawned yet: its first commit reports it as spawned
+    if (!changedBits) owner->changed.push_back(this);
+    changedBits |= bits;
 }
 
 void objManager::printTree(Object* obj, const std::string& prefix, bool isLast) {
@@ -251,6 +266,7 @@ Object* objManager::instantiate(const std::string& obj_class,
     Object* objPtr = registry.back().get();
     objPtr->setParent(getRoot());
     getRoot()->getChildren().push_back(objPtr); // raw pointer, OK
+    trackSpawn(objPtr);
 
 
 
@@ -259,9 +275,84 @@ Object* objManager::instantiate(const std::string& obj_class,
 
 void objManager::removeObjectsById(const std::vector<int>& ids) {
     if (ids.empty()) return;
+    std::unordered_set<int> doomed(ids.begin(), ids.end());
+    auto isDoomed = [&](const Object* o){ return o && o != root && doomed.count(o->id) != 0; };
+
+    // Unlink doomed objects from the hierarchy first so no surviving object keeps
+    // a dangling parent/child pointer; surviving children are re-attached to ROOT.
+    for (auto &o : registry) {
+        if (!isDoomed(o.get())) continue;
+        untrack(o.get());
+        Object* parent = o->getParent();
+        if (parent && !isDoomed(parent)) removeChild(parent, o.get());
+        std::vector<Object*> kids = o->getChildren();
+        for (Object* c : kids) {
+            if (!isDoomed(c)) addChild(getRoot(), c);
+        }
+    }
+
+    dropPending(isDoomed);
+
     registry.erase(std::remove_if(registry.begin(), registry.end(), [&](const std::unique_ptr<Object>& o){
-        if (!o) return false;
-        return std::find(ids.begin(), ids.end(), o->id) != ids.end();
+        return isDoomed(o.get());
     }), registry.end());
 }
 
+//----------------------------------
+// Change tracking
+//----------------------------------
+// Bookkeeping for an object about to be freed: out of the indices, reported as destroyed
+void objManager::untrack(Object* obj) {
+    grid.remove(obj);
+    byId.erase(obj->id);
+    pending.destroyed.push_back(obj->id);
+}
+
+// Anything spawned or changed earlier this frame that is about to be freed must not be reported
+void objManager::dropPending(const std::function<bool(const Object*)>& isDoomed) {
+    auto drop = [&](std::vector<Object*>& v){ v.erase(std::remove_if(v.begin(), v.end(), isDoomed), v.end()); };
+    drop(pending.spawned);
+    drop(pending.moved);
+    drop(pending.retextured);
+    drop(changed);
+}
+
+void objManager::trackSpawn(Object* obj) {
+    obj->owner = this;
+    pending.spawned.push_back(obj);
+    byId[obj->id] = obj;
+    // UI objects live in screen space and stay out of the spatial index
+    if (obj->obj_class != "ui") grid.insert(obj);
+}
+
+void objManager::commitChanges() {
+    // Spawned objects start from their current state and are not reported as moved.
+    // They were bucketed at instantiate(); re-bucket in case they were placed since.
+    for (Object* obj : pending.spawned) {
+        obj->trackedX = obj->x;
+        obj->trackedY = obj->y;
+        obj->trackedZ = obj->z;
+        obj->changedBits = 0;
+        grid.update(obj);
+    }
+    // Only objects queued by markChanged() can have moved or changed texture, so the
+    // commit costs what changed rather than the size of the registry
+    for (Object* obj : changed) {
+        uint8_t bits = obj->changedBits;
+        obj->changedBits = 0;
+        if ((bits & Object::CHANGED_MOVED) &&
+            (obj->x != obj->trackedX || obj->y != obj->trackedY || obj->z != obj->trackedZ)) {
+            obj->trackedX = obj->x;
+            obj->trackedY = obj->y;
+            obj->trackedZ = obj->z;
+            pending.moved.push_back(obj);
+            grid.update(obj);
+        }
+        if (bits & Object::CHANGED_TEXTURE) pending.retextured.push_back(obj);
+    }
+    changed.clear();
+    // publish and start the next frame, keeping vector capacity
+    std::swap(changes, pending);
+    pending.clear();
+    ++commits;
+}
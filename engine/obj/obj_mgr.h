@@ -5,10 +5,13 @@
 #include <vector>
 #include <algorithm>
 #include <memory>
+#include <iosfwd>
+#include <functional>
 #include <unordered_map>
 #include <json/json.h>
 #include "engine/obj/obj.h"
 #include "engine/obj/obj_factory.h"
+#include "engine/obj/spatial_grid.h"
 
 class objManager {
 public:
@@ -21,16 +24,58 @@ public:
                                 const std::string& name,
                                 float x, float y, float z);
     
+    // Resolve a prototype's texture path by texref (falls back to "default")
+    bool findPrototypeTexture(const std::string& obj_class, const std::string& obj_subclass,
+                              const std::string& texref, std::string& out) const;
+
     Object* createRoot();
     Object* getRoot() const { return root; }
 
+    // Live object by id (nullptr if it does not exist or was removed)
+    Object* findById(int id) const {
+        auto it = byId.find(id);
+        return it != byId.end() ? it->second : nullptr;
+    }
+
     void printRegistry() const;
 
     // Remove objects by id (used by scene unloading)
     void removeObjectsById(const std::vector<int>& ids);
 
+    // Binary snapshot of every live object (see obj_snapshot.cpp for the layout).
+    // readSnapshot replaces everything under ROOT; ids are preserved.
+    bool writeSnapshot(std::ostream& out) const;
+    bool readSnapshot(std::istream& in);
+    // Byte length of the snapshot at the stream's position, 0 if it is not one or runs
+    // past `available` bytes. The stream is left where it was, so data stored after a
+    // snapshot can be checked before readSnapshot replaces the world.
+    static uint64_t snapshotExtent(std::istream& in, uint64_t available);
+
     // Registry of live objects
     std::vector<std::unique_ptr<Object>> registry;
+
+    // Per-frame change tracking. Spawns and removals are recorded as they happen;
+    // moves and texture changes are queued by Object::markChanged() and sorted out by
+    // commitChanges(), which Engine::update calls once after all objects have updated.
+    // getChanges() then describes that frame until the next commit.
+    struct ChangeSet {
+        std::vector<Object*> moved;
+        std::vector<Object*> spawned;
+        std::vector<Object*> retextured; // texture or visibility changed
+        std::vector<int> destroyed; // ids only, the objects are already gone
+
+        bool empty() const { return moved.empty() && spawned.empty() && retextured.empty() && destroyed.empty(); }
+        void clear() { moved.clear(); spawned.clear(); retextured.clear(); destroyed.clear(); }
+    };
+    void commitChanges();
+    const ChangeSet& getChanges() const { return changes; }
+    // Number of commits so far; consumers that skipped a commit must resync from the registry
+    uint64_t commitSerial() const { return commits; }
+
+    // Spatial index over world objects (everything but ROOT and ui.*), keyed by
+    // tile cell. Objects are inserted on spawn, removed on destruction and
+    // re-bucketed by commitChanges() when they move.
+    SpatialGrid grid;
     
     friend class Object;
 
@@ -51,6 +96,16 @@ private:
     };
     Object* root = nullptr;
     std::vector<ObjectData> objectDefs;
+
+    std::unordered_map<int, Object*> byId;
+
+    ChangeSet pending; // accumulating for the current frame
+    ChangeSet changes; // last committed frame
+    std::vector<Object*> changed; // queued by Object::markChanged since the last commit
+    uint64_t commits = 0;
+    void trackSpawn(Object* obj);
+    void untrack(Object* obj);
+    void dropPending(const std::function<bool(const Object*)>& isDoomed);
 };
 
 #endif
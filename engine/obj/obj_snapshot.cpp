@@ -0,0 +1,329 @@
+#include "engine/obj/obj_mgr.h"
+#include <istream>
+#include <ostream>
+#include <cstring>
+#include <iostream>
+
+// Binary snapshot of the object world.
+//
+// Layout (native byte order, every section written with a single bulk write):
+//   SnapshotHeader
+//   SnapshotObject[objectCount]     record 0 is always ROOT
+//   uint32_t[childCount]            child record indices, sliced per object
+//   SnapshotProperty[propCount]     registered property values, sliced per object
+//   uint64_t[stringCount + 1]       offsets into the string blob
+//   char[stringBytes]               string blob (class names, names, textures, string props)
+//   unsigned char[stateBytes]       class-specific state from Object::saveState
+
+extern int counter; // next object id (obj_mgr.cpp)
+
+namespace {
+
+const char SNAPSHOT_MAGIC[4] = {'F', 'S', 'N', 'P'};
+const uint32_t SNAPSHOT_VERSION = 1;
+const uint32_t NO_PARENT = 0xFFFFFFFFu;
+
+enum : uint32_t {
+    SNAP_INVIS      = 1u << 0,
+    SNAP_MANUAL_TEX = 1u << 1,
+};
+
+struct SnapshotHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t objectCount;
+    uint32_t childCount;
+    uint32_t propCount;
+    uint32_t stringCount;
+    uint64_t stringBytes;
+    uint64_t stateBytes;
+};
+
+struct SnapshotObject {
+    int32_t id;
+    uint32_t parent;        // record index or NO_PARENT
+    uint32_t cls, subcls, name, texref, texture; // string table indices
+    uint32_t flags;
+    float x, y, z;
+    float lx, ly, lz;
+    uint32_t childBegin, childCount;
+    uint32_t propBegin, propCount;
+    uint64_t stateBegin, stateSize;
+};
+
+struct SnapshotProperty {
+    uint32_t name;          // string table index
+    uint32_t type;          // Object::PropType
+    uint32_t value;         // raw float/int/bool bits, or string table index
+};
+
+// Deduplicating string table. Per-field hint slots short-circuit the hash lookup
+// for runs of objects sharing a class, subclass or texture.
+struct StringTable {
+    std::unordered_map<std::string, uint32_t> index;
+    std::vector<uint64_t> offsets{0};
+    std::string blob;
+    struct Hint { std::string value; uint32_t id = 0xFFFFFFFFu; };
+    Hint hints[5];
+
+    uint32_t intern(const std::string& s, int hint) {
+        Hint &h = hints[hint];
+        if (h.id != 0xFFFFFFFFu && h.value == s) return h.id;
+        h.value = s;
+        h.id = intern(s);
+        return h.id;
+    }
+
+    uint32_t intern(const std::string& s) {
+        auto it = index.find(s);
+        if (it != index.end()) return it->second;
+        uint32_t id = static_cast<uint32_t>(offsets.size() - 1);
+        blob += s;
+        offsets.push_back(blob.size());
+        index.emplace(s, id);
+        return id;
+    }
+};
+
+template <typename T>
+void writeBulk(std::ostream& out, const std::vector<T>& v) {
+    if (!v.empty()) out.write(reinterpret_cast<const char*>(v.data()), std::streamsize(v.size() * sizeof(T)));
+}
+
+template <typename T>
+bool readBulk(std::istream& in, std::vector<T>& v, size_t count) {
+    v.resize(count);
+    if (count == 0) return true;
+    return bool(in.read(reinterpret_cast<char*>(v.data()), std::streamsize(count * sizeof(T))));
+}
+
+} // namespace
+
+bool objManager::writeSnapshot(std::ostream& out) const {
+    // Record index for every live object, looked up by id; ROOT is guaranteed to be registry[0]
+    int maxId = 0;
+    for (const auto &o : registry) if (o->id > maxId) maxId = o->id;
+    std::vector<uint32_t> recordById(size_t(maxId) + 1, NO_PARENT);
+    for (size_t i = 0; i < registry.size(); ++i) {
+        if (registry[i]->id >= 0) recordById[registry[i]->id] = static_cast<uint32_t>(i);
+    }
+    auto recordOf = [&](const Object* o) -> uint32_t {
+        if (!o || o->id < 0 || o->id > maxId) return NO_PARENT;
+        uint32_t r = recordById[o->id];
+        return (r != NO_PARENT && registry[r].get() == o) ? r : NO_PARENT;
+    };
+
+    StringTable strings;
+    std::vector<SnapshotObject> objects(registry.size());
+    std::vector<uint32_t> children;
+    std::vector<SnapshotProperty> props;
+    std::vector<unsigned char> state;
+    children.reserve(registry.size());
+
+    for (size_t i = 0; i < registry.size(); ++i) {
+        const Object* obj = registry[i].get();
+        SnapshotObject &rec = objects[i];
+
+        rec.id = obj->id;
+        rec.parent = recordOf(obj->getParent());
+        rec.cls = strings.intern(obj->obj_class, 0);
+        rec.subcls = strings.intern(obj->obj_subclass, 1);
+        rec.name = strings.intern(obj->objName, 2);
+        rec.texref = strings.intern(obj->texref, 3);
+        rec.texture = strings.intern(obj->texture, 4);
+        rec.flags = (obj->invis ? SNAP_INVIS : 0u) | (obj->manualTex ? SNAP_MANUAL_TEX : 0u);
+        rec.x = obj->x; rec.y = obj->y; rec.z = obj->z;
+        rec.lx = obj->lx; rec.ly = obj->ly; rec.lz = obj->lz;
+
+        // children are stored as record indices; anything no longer in the registry is dropped
+        rec.childBegin = static_cast<uint32_t>(children.size());
+        for (Object* c : const_cast<Object*>(obj)->getChildren()) {
+            uint32_t ci = recordOf(c);
+            if (ci != NO_PARENT) children.push_back(ci);
+        }
+        rec.childCount = static_cast<uint32_t>(children.size()) - rec.childBegin;
+
+        rec.propBegin = static_cast<uint32_t>(props.size());
+        if (i != 0) {
+            for (const auto &p : obj->getProperties()) {
+                // "texture" and "manualTex" are core fields already stored in the record
+                if (p.type == Object::PropType::Custom || p.ref == &obj->texture || p.ref == &obj->manualTex) continue;
+                SnapshotProperty sp{strings.intern(p.name), static_cast<uint32_t>(p.type), 0};
+                switch (p.type) {
+                    case Object::PropType::Float:  memcpy(&sp.value, p.ref, sizeof(float)); break;
+                    case Object::PropType::Int:    memcpy(&sp.value, p.ref, sizeof(int32_t)); break;
+                    case Object::PropType::Bool:   sp.value = *static_cast<const bool*>(p.ref) ? 1u : 0u; break;
+                    case Object::PropType::String: sp.value = strings.intern(*static_cast<const std::string*>(p.ref)); break;
+                    case Object::PropType::Custom: break;
+                }
+                props.push_back(sp);
+            }
+        }
+        rec.propCount = static_cast<uint32_t>(props.size()) - rec.propBegin;
+
+        rec.stateBegin = state.size();
+        obj->saveState(state);
+        rec.stateSize = state.size() - rec.stateBegin;
+    }
+
+    SnapshotHeader hdr{};
+    memcpy(hdr.magic, SNAPSHOT_MAGIC, sizeof(hdr.magic));
+    hdr.version = SNAPSHOT_VERSION;
+    hdr.objectCount = static_cast<uint32_t>(objects.size());
+    hdr.childCount = static_cast<uint32_t>(children.size());
+    hdr.propCount = static_cast<uint32_t>(props.size());
+    hdr.stringCount = static_cast<uint32_t>(strings.offsets.size() - 1);
+    hdr.stringBytes = strings.blob.size();
+    hdr.stateBytes = state.size();
+
+    out.write(reinterpret_cast<const char*>(&hdr), sizeof(hdr));
+    writeBulk(out, objects);
+    writeBulk(out, children);
+    writeBulk(out, props);
+    writeBulk(out, strings.offsets);
+    out.write(strings.blob.data(), std::streamsize(strings.blob.size()));
+    writeBulk(out, state);
+    return bool(out);
+}
+
+uint64_t objManager::snapshotExtent(std::istream& in, uint64_t available) {
+    std::streampos start = in.tellg();
+    SnapshotHeader hdr{};
+    bool ok = bool(in.read(reinterpret_cast<char*>(&hdr), sizeof(hdr)));
+    in.clear();
+    in.seekg(start);
+    if (!ok || memcmp(hdr.magic, SNAPSHOT_MAGIC, sizeof(hdr.magic)) != 0) return 0;
+    // counts are 32-bit, so the fixed-size sections cannot overflow; the blob sizes are checked first
+    if (hdr.stringBytes > available || hdr.stateBytes > available) return 0;
+    uint64_t bytes = sizeof(hdr)
+        + uint64_t(hdr.objectCount) * sizeof(SnapshotObject)
+        + uint64_t(hdr.childCount) * sizeof(uint32_t)
+        + uint64_t(hdr.propCount) * sizeof(SnapshotProperty)
+        + (uint64_t(hdr.stringCount) + 1) * sizeof(uint64_t)
+        + hdr.stringBytes + hdr.stateBytes;
+    return bytes <= available ? bytes : 0;
+}
+
+bool objManager::readSnapshot(std::istream& in) {
+    SnapshotHeader hdr{};
+    if (!in.read(reinterpret_cast<char*>(&hdr), sizeof(hdr)) || memcmp(hdr.magic, SNAPSHOT_MAGIC, sizeof(hdr.magic)) != 0) {
+        std::cerr << "readSnapshot: not a FOOSIE snapshot\n";
+        return false;
+    }
+    if (hdr.version != SNAPSHOT_VERSION) {
+        std::cerr << "readSnapshot: unsupported snapshot version " << hdr.version
+                  << " (expected " << SNAPSHOT_VERSION << ")\n";
+        return false;
+    }
+    if (hdr.objectCount == 0) {
+        std::cerr << "readSnapshot: snapshot has no ROOT record\n";
+        return false;
+    }
+
+    // Read every section before touching the live registry so a truncated file leaves it intact
+    std::vector<SnapshotObject> objects;
+    std::vector<uint32_t> children;
+    std::vector<SnapshotProperty> props;
+    std::vector<uint64_t> offsets;
+    std::string blob(hdr.stringBytes, '\0');
+    std::vector<unsigned char> state;
+    if (!readBulk(in, objects, hdr.objectCount) ||
+        !readBulk(in, children, hdr.childCount) ||
+        !readBulk(in, props, hdr.propCount) ||
+        !readBulk(in, offsets, size_t(hdr.stringCount) + 1) ||
+        (hdr.stringBytes && !in.read(&blob[0], std::streamsize(hdr.stringBytes))) ||
+        !readBulk(in, state, hdr.stateBytes)) {
+        std::cerr << "readSnapshot: snapshot is truncated\n";
+        return false;
+    }
+
+    std::vector<std::string> strings(hdr.stringCount);
+    for (uint32_t i = 0; i < hdr.stringCount; ++i) {
+        if (offsets[i] > offsets[i + 1] || offsets[i + 1] > blob.size()) {
+            std::cerr << "readSnapshot: corrupt string table\n";
+            return false;
+        }
+        strings[i].assign(blob, offsets[i], offsets[i + 1] - offsets[i]);
+    }
+    auto str = [&](uint32_t idx) -> const std::string& {
+        static const std::string empty;
+        return idx < strings.size() ? strings[idx] : empty;
+    };
+
+    // Drop everything but ROOT, then bulk-instantiate. Change tracking sees the
+    // whole old world destroyed and the restored one spawned; removals already
+    // recorded this frame are kept.
+    for (size_t i = 1; i < registry.size(); ++i) untrack(registry[i].get());
+    dropPending([this](const Object* o){ return o != root; });
+    grid.clear();
+    registry.erase(registry.begin() + 1, registry.end());
+    root->getChildren().clear();
+    registry.reserve(hdr.objectCount);
+
+    std::vector<Object*> created(hdr.objectCount, nullptr);
+    created[0] = root;
+    std::unordered_map<uint32_t, const ObjectFactory::Creator*> creators;
+    int maxId = 0;
+
+    for (uint32_t i = 1; i < hdr.objectCount; ++i) {
+        const SnapshotObject &rec = objects[i];
+        auto cit = creators.find(rec.cls);
+        if (cit == creators.end()) cit = creators.emplace(rec.cls, ObjectFactory::getCreator(str(rec.cls))).first;
+        if (!cit->second) {
+            std::cerr << "readSnapshot: unknown object class '" << str(rec.cls) << "', skipping id " << rec.id << "\n";
+            continue;
+        }
+        std::unique_ptr<Object> obj = (*cit->second)();
+        if (!obj) continue;
+
+        obj->id = rec.id;
+        obj->obj_class = str(rec.cls);
+        obj->obj_subclass = str(rec.subcls);
+        obj->objName = str(rec.name);
+        obj->texref = str(rec.texref);
+        obj->x = rec.x; obj->y = rec.y; obj->z = rec.z;
+        obj->lx = rec.lx; obj->ly = rec.ly; obj->lz = rec.lz;
+
+        for (uint32_t p = rec.propBegin; p < rec.propBegin + rec.propCount && p < props.size(); ++p) {
+            const SnapshotProperty &sp = props[p];
+            Object::Property* prop = obj->findProperty(str(sp.name));
+            if (!prop || static_cast<uint32_t>(prop->type) != sp.type) continue;
+            switch (prop->type) {
+                case Object::PropType::Float:  memcpy(prop->ref, &sp.value, sizeof(float)); break;
+                case Object::PropType::Int:    memcpy(prop->ref, &sp.value, sizeof(int32_t)); break;
+                case Object::PropType::Bool:   *static_cast<bool*>(prop->ref) = sp.value != 0; break;
+                case Object::PropType::String: *static_cast<std::string*>(prop->ref) = str(sp.value); break;
+                case Object::PropType::Custom: break;
+            }
+        }
+        obj->texture = str(rec.texture);
+        obj->invis = (rec.flags & SNAP_INVIS) != 0;
+        obj->manualTex = (rec.flags & SNAP_MANUAL_TEX) != 0;
+
+        if (rec.stateSize && rec.stateBegin + rec.stateSize <= state.size()) {
+            obj->loadState(state.data() + rec.stateBegin, size_t(rec.stateSize));
+        }
+
+        if (rec.id > maxId) maxId = rec.id;
+        created[i] = obj.get();
+        registry.push_back(std::move(obj));
+        trackSpawn(created[i]);
+    }
+
+    // Rebuild the hierarchy in the recorded child order
+    for (uint32_t i = 0; i < hdr.objectCount; ++i) {
+        Object* obj = created[i];
+        if (!obj) continue;
+        const SnapshotObject &rec = objects[i];
+        if (i != 0) obj->setParent(rec.parent < hdr.objectCount ? created[rec.parent] : nullptr);
+        auto &kids = obj->getChildren();
+        kids.reserve(rec.childCount);
+        for (uint32_t c = rec.childBegin; c < rec.childBegin + rec.childCount && c < children.size(); ++c) {
+            uint32_t ci = children[c];
+            if (ci < hdr.objectCount && created[ci]) kids.push_back(created[ci]);
+        }
+    }
+
+    if (counter <= maxId) counter = maxId + 1;
+    return true;
+}
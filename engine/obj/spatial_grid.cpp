@@ -0,0 +1,98 @@
+#include "engine/obj/spatial_grid.h"
+#include "engine/obj/obj.h"
+#include <algorithm>
+#include <cmath>
+
+int SpatialGrid::cellOf(float v) const {
+    return int(std::floor(v / cellSize));
+}
+
+void SpatialGrid::insert(Object* obj) {
+    if (!obj || obj->inGrid) return;
+    obj->gridCX = cellOf(obj->x);
+    obj->gridCY = cellOf(obj->y);
+    obj->inGrid = true;
+    noteZ(obj->z);
+    cells[key(obj->gridCX, obj->gridCY)].push_back(obj);
+    ++count;
+}
+
+void SpatialGrid::remove(Object* obj) {
+    if (!obj || !obj->inGrid) return;
+    auto it = cells.find(key(obj->gridCX, obj->gridCY));
+    if (it != cells.end()) {
+        auto &bucket = it->second;
+        auto pos = std::find(bucket.begin(), bucket.end(), obj);
+        if (pos != bucket.end()) {
+            *pos = bucket.back();
+            bucket.pop_back();
+            --count;
+        }
+        if (bucket.empty()) cells.erase(it);
+    }
+    obj->inGrid = false;
+}
+
+void SpatialGrid::update(Object* obj) {
+    if (!obj || !obj->inGrid) return;
+    noteZ(obj->z);
+    if (cellOf(obj->x) == obj->gridCX && cellOf(obj->y) == obj->gridCY) return;
+    remove(obj);
+    insert(obj);
+}
+
+void SpatialGrid::clear() {
+    for (auto &c : cells) {
+        for (Object* obj : c.second) obj->inGrid = false;
+    }
+    cells.clear();
+    count = 0;
+    zSeen = false;
+}
+
+template <typename Fn>
+void SpatialGrid::forCells(int cx0, int cy0, int cx1, int cy1, Fn&& fn) const {
+    if (cx1 < cx0 || cy1 < cy0) return;
+    uint64_t area = uint64_t(int64_t(cx1) - cx0 + 1) * uint64_t(int64_t(cy1) - cy0 + 1);
+    if (area <= cells.size()) {
+        // small query: probe each cell in the range
+        for (int cy = cy0; cy <= cy1; ++cy) {
+            for (int cx = cx0; cx <= cx1; ++cx) {
+                auto it = cells.find(key(cx, cy));
+                if (it != cells.end()) fn(it->second);
+            }
+        }
+    } else {
+        // query larger than the populated world: walk occupied cells instead
+        for (auto &c : cells) {
+            int cx = keyX(c.first), cy = keyY(c.first);
+            if (cx >= cx0 && cx <= cx1 && cy >= cy0 && cy <= cy1) fn(c.second);
+        }
+    }
+}
+
+void SpatialGrid::queryCell(int cx, int cy, std::vector<Object*>& out) const {
+    auto it = cells.find(key(cx, cy));
+    if (it != cells.end()) out.insert(out.end(), it->second.begin(), it->second.end());
+}
+
+void SpatialGrid::queryRect(float x0, float y0, float x1, float y1, std::vector<Object*>& out) const {
+    if (x1 < x0) std::swap(x0, x1);
+    if (y1 < y0) std::swap(y0, y1);
+    forCells(cellOf(x0), cellOf(y0), cellOf(x1), cellOf(y1), [&](const std::vector<Object*>& bucket){
+        for (Object* obj : bucket) {
+            if (obj->x >= x0 && obj->x <= x1 && obj->y >= y0 && obj->y <= y1) out.push_back(obj);
+        }
+    });
+}
+
+void SpatialGrid::queryRadius(float x, float y, float r, std::vector<Object*>& out) const {
+    if (r < 0.0f) return;
+    const float r2 = r * r;
+    forCells(cellOf(x - r), cellOf(y - r), cellOf(x + r), cellOf(y + r), [&](const std::vector<Object*>& bucket){
+        for (Object* obj : bucket) {
+            float dx = obj->x - x, dy = obj->y - y;
+            if (dx * dx + dy * dy <= r2) out.push_back(obj);
+        }
+    });
+}
@@ -0,0 +1,66 @@
+#ifndef SPATIAL_GRID_H
+#define SPATIAL_GRID_H
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+class Object;
+
+// Uniform spatial hash over world objects, keyed by iso tile cell (floor of x/y).
+// Only occupied cells are stored, so memory follows the object count rather than
+// the world extent. Queries append to the caller's vector and cost is
+// proportional to the queried area (or the occupied cells, whichever is smaller).
+class SpatialGrid {
+public:
+    explicit SpatialGrid(float cellSize = 1.0f) : cellSize(cellSize) {}
+
+    void insert(Object* obj);
+    void remove(Object* obj);
+    // re-bucket an object after it moved (cheap no-op if it stayed in its cell)
+    void update(Object* obj);
+    void clear();
+
+    // Objects whose position lies in cell (cx, cy)
+    void queryCell(int cx, int cy, std::vector<Object*>& out) const;
+    // Objects with x in [x0, x1] and y in [y0, y1] (world units)
+    void queryRect(float x0, float y0, float x1, float y1, std::vector<Object*>& out) const;
+    // Objects within distance r of (x, y) on the ground plane
+    void queryRadius(float x, float y, float r, std::vector<Object*>& out) const;
+
+    // Range of z seen since the last clear (grows only; a conservative bound for picking)
+    bool hasZRange() const { return zSeen; }
+    float minZ() const { return zMin; }
+    float maxZ() const { return zMax; }
+
+    int cellOf(float v) const;
+    float getCellSize() const { return cellSize; }
+    size_t objectCount() const { return count; }
+    size_t cellCount() const { return cells.size(); }
+
+private:
+    static uint64_t key(int cx, int cy) {
+        return (uint64_t(uint32_t(cx)) << 32) | uint64_t(uint32_t(cy));
+    }
+    static int keyX(uint64_t k) { return int32_t(uint32_t(k >> 32)); }
+    static int keyY(uint64_t k) { return int32_t(uint32_t(k)); }
+
+    // visit every occupied cell overlapping [cx0, cx1] x [cy0, cy1]
+    template <typename Fn>
+    void forCells(int cx0, int cy0, int cx1, int cy1, Fn&& fn) const;
+
+    void noteZ(float z) {
+        if (!zSeen) { zMin = zMax = z; zSeen = true; return; }
+        if (z < zMin) zMin = z;
+        if (z > zMax) zMax = z;
+    }
+
+    float cellSize = 1.0f;
+    size_t count = 0;
+    bool zSeen = false;
+    float zMin = 0.0f, zMax = 0.0f;
+    std::unordered_map<uint64_t, std::vector<Object*>> cells;
+};
+
+#endif // SPATIAL_GRID_H
@@ -0,0 +1,115 @@
+#include "engine/render/atlas_packer.h"
+#include <algorithm>
+#include <climits>
+
+AtlasPacker::AtlasPacker(int pageW, int pageH, int padding)
+    : pageW(pageW), pageH(pageH), pad(padding) {}
+
+void AtlasPacker::clear() {
+    pages.clear();
+}
+
+AtlasPacker::Page AtlasPacker::newPage() const {
+    Page p;
+    p.free.push_back(Rect{0, 0, pageW, pageH});
+    return p;
+}
+
+bool AtlasPacker::findPosition(const Page& page, int w, int h, Rect& best, int& bestShort, int& bestLong) {
+    bool found = false;
+    for (const Rect &f : page.free) {
+        if (w > f.w || h > f.h) continue;
+        int leftW = f.w - w, leftH = f.h - h;
+        int shortSide = std::min(leftW, leftH), longSide = std::max(leftW, leftH);
+        if (shortSide < bestShort || (shortSide == bestShort && longSide < bestLong)) {
+            best = Rect{f.x, f.y, w, h};
+            bestShort = shortSide;
+            bestLong = longSide;
+            found = true;
+        }
+    }
+    return found;
+}
+
+void AtlasPacker::place(Page& page, const Rect& used) {
+    // split every free rect the placement overlaps into the (up to four) maximal
+    // rects around it
+    std::vector<Rect> &free = page.free;
+    const size_t count = free.size();
+    for (size_t i = 0; i < count; ++i) {
+        Rect f = free[i];
+        if (used.x >= f.x + f.w || used.x + used.w <= f.x || used.y >= f.y + f.h || used.y + used.h <= f.y) continue;
+        if (used.x > f.x) free.push_back(Rect{f.x, f.y, used.x - f.x, f.h});
+        if (used.x + used.w < f.x + f.w) free.push_back(Rect{used.x + used.w, f.y, f.x + f.w - (used.x + used.w), f.h});
+        if (used.y > f.y) free.push_back(Rect{f.x, f.y, f.w, used.y - f.y});
+        if (used.y + used.h < f.y + f.h) free.push_back(Rect{f.x, used.y + used.h, f.w, f.y + f.h - (used.y + used.h)});
+        free[i].w = 0; // consumed
+    }
+    free.erase(std::remove_if(free.begin(), free.end(), [](const Rect& r){ return r.w <= 0 || r.h <= 0; }), free.end());
+    prune(page);
+}
+
+void AtlasPacker::prune(Page& page) {
+    // drop rects contained in another one
+    std::vector<Rect> &free = page.free;
+    auto contains = [](const Rect& a, const Rect& b) {
+        return b.x >= a.x && b.y >= a.y && b.x + b.w <= a.x + a.w && b.y + b.h <= a.y + a.h;
+    };
+    for (size_t i = 0; i < free.size(); ++i) {
+        for (size_t j = i + 1; j < free.size(); ++j) {
+            if (contains(free[j], free[i])) {
+                free.erase(free.begin() + i);
+                --i;
+                break;
+            }
+            if (contains(free[i], free[j])) {
+                free.erase(free.begin() + j);
+                --j;
+            }
+        }
+    }
+}
+
+bool AtlasPacker::insert(int w, int h, Slot& out, bool openPage) {
+    if (w <= 0 || h <= 0) return false;
+    // padding only counts where it fits: a rect may end exactly at the page edge
+    const int pw = std::min(w + pad, pageW), ph = std::min(h + pad, pageH);
+    if (w > pageW || h > pageH) return false;
+
+    Rect best{0, 0, 0, 0};
+    int bestPage = -1, bestShort = INT_MAX, bestLong = INT_MAX;
+    for (size_t i = 0; i < pages.size(); ++i) {
+        if (findPosition(pages[i], pw, ph, best, bestShort, bestLong)) bestPage = int(i);
+    }
+    if (bestPage < 0) {
+        if (!openPage) return false;
+        pages.push_back(newPage());
+        bestPage = int(pages.size()) - 1;
+        findPosition(pages.back(), pw, ph, best, bestShort, bestLong);
+    }
+
+    Page &page = pages[bestPage];
+    place(page, best);
+    page.used += uint64_t(w) * uint64_t(h);
+    out.page = bestPage;
+    out.x = best.x;
+    out.y = best.y;
+    return true;
+}
+
+void AtlasPacker::release(const Slot& slot, int w, int h) {
+    if (slot.page < 0 || slot.page >= int(pages.size()) || w <= 0 || h <= 0) return;
+    Page &page = pages[slot.page];
+    // the same padded footprint insert() reserved
+    const int pw = std::min(w + pad, pageW - slot.x), ph = std::min(h + pad, pageH - slot.y);
+    page.free.push_back(Rect{slot.x, slot.y, pw, ph});
+    prune(page);
+    page.used -= std::min(page.used, uint64_t(w) * uint64_t(h));
+}
+
+double AtlasPacker::occupancy() const {
+    if (pages.empty()) return 0.0;
+    uint64_t used = 0;
+    for (const Page &p : pages) used += p.used;
+    return double(used) / (double(pageW) * double(pageH) * double(pages.size()));
+}
@@ -0,0 +1,55 @@
+#ifndef ATLAS_PACKER_H
+#define ATLAS_PACKER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// MaxRects bin packer for atlas pages.
+//
+// Each page keeps the list of maximal free rectangles left after the placements so
+// far. A new rect goes where it leaves the shortest leftover side (best short side
+// fit), checked across every open page; a new page is opened only when nothing fits.
+// Rects are padded on the right and bottom so neighbours never touch. Callers get
+// the densest results by inserting large rects first. Released rects go back on the
+// free list as they are (not merged with their neighbours), so space freed piecemeal
+// fragments until the caller repacks.
+class AtlasPacker {
+public:
+    struct Slot {
+        int page = 0;
+        int x = 0, y = 0;
+    };
+
+    explicit AtlasPacker(int pageW = 2048, int pageH = 2048, int padding = 1);
+
+    // Place a w x h rect; false when it can't fit on an empty page, or (openPage false)
+    // in the free space of the pages already open
+    bool insert(int w, int h, Slot& out, bool openPage = true);
+    // give back a rect placed by insert (same w, h); its space is reused by later inserts
+    void release(const Slot& slot, int w, int h);
+    void clear();
+
+    int pageCount() const { return int(pages.size()); }
+    int pageWidth() const { return pageW; }
+    int pageHeight() const { return pageH; }
+    // placed area (without padding) over the area of all open pages, 0..1
+    double occupancy() const;
+
+private:
+    struct Rect { int x, y, w, h; };
+    struct Page {
+        std::vector<Rect> free;
+        uint64_t used = 0;
+    };
+
+    Page newPage() const;
+    static bool findPosition(const Page& page, int w, int h, Rect& best, int& bestShort, int& bestLong);
+    static void place(Page& page, const Rect& used);
+    static void prune(Page& page);
+
+    int pageW, pageH, pad;
+    std::vector<Page> pages;
+};
+
+#endif // ATLAS_PACKER_H
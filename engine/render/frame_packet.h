@@ -0,0 +1,40 @@
+#ifndef FRAME_PACKET_H
+#define FRAME_PACKET_H
+
+#include <cstddef>
+#include <functional>
+#include <vector>
+
+#include "engine/render/iso_projection.h"
+
+// Where a draw's streamed data lives: a stream ring offset when the layers draw inline,
+// an offset into the frame packet's stream when the render thread uploads it later
+// (renderPipeline::streamOffset resolves either once the GL work runs).
+struct StreamRef {
+    size_t offset = 0;
+    bool inPacket = false;
+};
+
+// One frame of GL work recorded by the main thread for the render thread.
+//
+// Everything a packet needs is in it: the camera block, the frame's streamed vertex and
+// instance bytes, and the GL commands in submission order. Commands capture copies (or
+// shared ownership) of what they read, never pointers into simulation state, so the main
+// thread can go on to the next frame while this one is submitted.
+struct FramePacket {
+    // the packet's ring region is aligned to a multiple of every streamed element size
+    // (SpriteInstance 36, QuadVertex 16, float vertices 32), so offsets inside the stream
+    // stay whole elements once it is uploaded
+    static const size_t ALIGN = 288;
+
+    IsoProjection::Block view{};
+    std::vector<unsigned char> stream;
+    std::vector<std::function<void()>> commands;
+
+    void clear() {
+        stream.clear();
+        commands.clear();
+    }
+};
+
+#endif // FRAME_PACKET_H
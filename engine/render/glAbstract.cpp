@@ -1,23 +1,183 @@
 #include "engine/render/glAbstract.h"
+#include <cstring>
+#include <iostream>
+#include <unordered_map>
 
 GLsizei stride = 8 * sizeof(float); // 3 pos + 3 color + 2 uv = 8 floats
 
+// ---------------- glState
+
+namespace {
+
+const GLuint UNKNOWN = ~0u; // not set through the cache yet: the next call is issued
+
+struct AttributeSource { GLuint buffer; size_t offset; };
+
+struct StateCache {
+    GLuint program = UNKNOWN;
+    GLuint vertexArray = UNKNOWN;
+    std::unordered_map<GLenum, GLuint> buffers;         // by target, except element arrays
+    std::unordered_map<GLuint, GLuint> elementBuffers;  // by VAO
+    std::unordered_map<GLuint, AttributeSource> attributes; // by VAO
+    GLenum activeUnit = UNKNOWN;
+    std::unordered_map<uint64_t, GLuint> textures;      // by (unit, target)
+    std::unordered_map<GLenum, bool> caps;
+    GLenum blendSrc = UNKNOWN, blendDst = UNKNOWN, depth = UNKNOWN;
+    std::unordered_map<uint64_t, GLint> uniforms;       // by (program, location)
+    uint64_t issued = 0, avoided = 0;
+
+    // true (and counted) when `slot` already holds `value`; otherwise stores it
+    template <typename T>
+    bool same(T& slot, T value) {
+        if (slot == value) { ++avoided; return true; }
+        slot = value;
+        ++issued;
+        return false;
+    }
+};
+
+StateCache cache;
+
+} // namespace
+
+namespace glState {
+
+void useProgram(GLuint program) {
+    if (!cache.same(cache.program, program)) glUseProgram(program);
+}
+
+void bindVertexArray(GLuint vao) {
+    if (!cache.same(cache.vertexArray, vao)) glBindVertexArray(vao);
+}
+
+void bindBuffer(GLenum target, GLuint buffer) {
+    if (target == GL_ELEMENT_ARRAY_BUFFER) {
+        if (cache.vertexArray == UNKNOWN) { ++cache.issued; glBindBuffer(target, buffer); return; }
+        auto it = cache.elementBuffers.try_emplace(cache.vertexArray, UNKNOWN).first;
+        if (!cache.same(it->second, buffer)) glBindBuffer(target, buffer);
+        return;
+    }
+    auto it = cache.buffers.try_emplace(target, UNKNOWN).first;
+    if (!cache.same(it->second, buffer)) glBindBuffer(target, buffer);
+}
+
+void activeTexture(GLenum unit) {
+    if (!cache.same(cache.activeUnit, unit)) glActiveTexture(unit);
+}
+
+void bindTexture(GLenum target, GLuint texture) {
+    if (cache.activeUnit == UNKNOWN) activeTexture(GL_TEXTURE0); // the GL default
+    auto it = cache.textures.try_emplace((uint64_t(cache.activeUnit) << 32) | target, UNKNOWN).first;
+    if (!cache.same(it->second, texture)) glBindTexture(target, texture);
+}
+
+void enable(GLenum cap, bool on) {
+    auto it = cache.caps.find(cap);
+    if (it != cache.caps.end() && it->second == on) { ++cache.avoided; return; }
+    cache.caps[cap] = on;
+    ++cache.issued;
+    if (on) glEnable(cap);
+    else glDisable(cap);
+}
+
+void blendFunc(GLenum src, GLenum dst) {
+    if (cache.blendSrc == src && cache.blendDst == dst) { ++cache.avoided; return; }
+    cache.blendSrc = src;
+    cache.blendDst = dst;
+    ++cache.issued;
+    glBlendFunc(src, dst);
+}
+
+void depthFunc(GLenum func) {
+    if (!cache.same(cache.depth, func)) glDepthFunc(func);
+}
+
+void uniform1i(GLint location, GLint value) {
+    if (location < 0) return; // not an active uniform
+    if (cache.program == UNKNOWN) { ++cache.issued; glUniform1i(location, value); return; }
+    auto it = cache.uniforms.find((uint64_t(cache.program) << 32) | uint32_t(location));
+    if (it != cache.uniforms.end() && it->second == value) { ++cache.avoided; return; }
+    cache.uniforms[(uint64_t(cache.program) << 32) | uint32_t(location)] = value;
+    ++cache.issued;
+    glUniform1i(location, value);
+}
+
+bool attributesAt(GLuint buffer, size_t offset, unsigned calls) {
+    if (cache.vertexArray == UNKNOWN) return false;
+    auto it = cache.attributes.find(cache.vertexArray);
+    if (it != cache.attributes.end() && it->second.buffer == buffer && it->second.offset == offset) {
+        cache.avoided += calls;
+        return true;
+    }
+    cache.attributes[cache.vertexArray] = AttributeSource{buffer, offset};
+    cache.issued += calls;
+    return false;
+}
+
+void deleteBuffer(GLuint buffer) {
+    if (!buffer) return;
+    glDeleteBuffers(1, &buffer);
+    // GL unbinds it from the context; VAOs other than the bound one keep the old object,
+    // so their entries are dropped rather than set to 0
+    for (auto &b : cache.buffers) {
+        if (b.second == buffer) b.second = 0;
+    }
+    for (auto it = cache.elementBuffers.begin(); it != cache.elementBuffers.end();) {
+        if (it->second == buffer) it = cache.elementBuffers.erase(it);
+        else ++it;
+    }
+    for (auto it = cache.attributes.begin(); it != cache.attributes.end();) {
+        if (it->second.buffer == buffer) it = cache.attributes.erase(it);
+        else ++it;
+    }
+}
+
+void deleteTexture(GLuint texture) {
+    if (!texture) return;
+    glDeleteTextures(1, &texture);
+    for (auto &t : cache.textures) {
+        if (t.second == texture) t.second = 0;
+    }
+}
+
+void deleteVertexArray(GLuint vao) {
+    if (!vao) return;
+    glDeleteVertexArrays(1, &vao);
+    cache.elementBuffers.erase(vao);
+    cache.attributes.erase(vao);
+    if (cache.vertexArray == vao) cache.vertexArray = 0;
+}
+
+void reset() {
+    const uint64_t issued = cache.issued, avoided = cache.avoided;
+    cache = StateCache();
+    cache.issued = issued;
+    cache.avoided = avoided;
+}
+
+uint64_t issuedCalls() { return cache.issued; }
+uint64_t avoidedCalls() { return cache.avoided; }
+
+} // namespace glState
+
+// ---------------- vao / vbo
+
 vao::vao(){
     glGenVertexArrays(1, &VAO);
     // Do NOT bind here permanently: binding is harmless here but we'll re-bind
     // where needed. Keep constructor simple.
-    glBindVertexArray(VAO);
+    glState::bindVertexArray(VAO);
 }
 vao::~vao(){
-    glDeleteVertexArrays(1, &VAO);
+    glState::deleteVertexArray(VAO);
 }
 void vao::bind(){
-    glBindVertexArray(VAO);
+    glState::bindVertexArray(VAO);
 }
 
 vbo::vbo(const float* vertices, size_t count) {
     glGenBuffers(1, &VBO);
-    glBindBuffer(GL_ARRAY_BUFFER, VBO);
+    glState::bindBuffer(GL_ARRAY_BUFFER, VBO);
     glBufferData(GL_ARRAY_BUFFER, count * sizeof(float), vertices, GL_STATIC_DRAW);
     glEnableVertexAttribArray(0); // position
     glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8*sizeof(float), (void*)0);
@@ -29,18 +189,13 @@ vbo::vbo(const float* vertices, size_t count) {
 }
 
 void vbo::bind(){
-    glBindBuffer(GL_ARRAY_BUFFER, VBO);
-    glEnableVertexAttribArray(0); // position
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8*sizeof(float), (void*)0);
-    glEnableVertexAttribArray(1); // normal/color
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 8*sizeof(float), (void*)(3*sizeof(float)));
-    glEnableVertexAttribArray(2); // uv
-    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 8*sizeof(float), (void*)(6*sizeof(float)));
+    // the attribute layout lives in the VAO (set up by the constructor)
+    glState::bindBuffer(GL_ARRAY_BUFFER, VBO);
 }
 
 
 void vbo::update(const float* data, size_t count) {
-    glBindBuffer(GL_ARRAY_BUFFER, VBO); // <- was id
+    glState::bindBuffer(GL_ARRAY_BUFFER, VBO); // <- was id
     glBufferData(GL_ARRAY_BUFFER, count * sizeof(float), data, GL_DYNAMIC_DRAW);
     this->floatCount = static_cast<GLsizei>(count);
 }
@@ -48,7 +203,159 @@ void vbo::update(const float* data, size_t count) {
 
 
 vbo::~vbo(){
-    glDeleteBuffers(1, &VBO);
+    glState::deleteBuffer(VBO);
+}
+
+// ---------------- streamBuffer
+
+streamBuffer::streamBuffer(size_t capacityBytes, GLenum target) : target(target) {
+    glGenBuffers(1, &buffer);
+    grow(capacityBytes > 0 ? capacityBytes : 1024);
+}
+
+streamBuffer::~streamBuffer() {
+    for (auto &f : fences) glDeleteSync(f.sync);
+    glState::deleteBuffer(buffer);
+}
+
+void streamBuffer::bind() {
+    glState::bindBuffer(target, buffer);
+}
+
+void streamBuffer::bindVertexLayout() {
+    glState::bindBuffer(GL_ARRAY_BUFFER, buffer);
+    glEnableVertexAttribArray(0); // position
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, stride, (void*)0);
+    glEnableVertexAttribArray(1); // normal/color
+    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, stride, (void*)(3*sizeof(float)));
+    glEnableVertexAttribArray(2); // uv
+    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, stride, (void*)(6*sizeof(float)));
+}
+
+void streamBuffer::grow(size_t minBytes) {
+    size_t newCap = cap ? cap : minBytes;
+    while (newCap < minBytes) newCap *= 2;
+    // fresh storage: draws already issued keep reading the old (orphaned) storage
+    glState::bindBuffer(target, buffer);
+    glBufferData(target, newCap, nullptr, GL_STREAM_DRAW);
+    unbindPixelTarget();
+    cap = newCap;
+    head = 0;
+    for (auto &f : fences) glDeleteSync(f.sync);
+    fences.clear();
+    frameRanges.clear();
+}
+
+bool streamBuffer::overlaps(const std::vector<Range>& ranges, size_t begin, size_t end) {
+    for (const auto &r : ranges) {
+        if (begin < r.end && r.begin < end) return true;
+    }
+    return false;
+}
+
+void streamBuffer::retireSignaled() {
+    // the GPU finishes frames in order: drop fences from the front while they're signaled
+    size_t done = 0;
+    while (done < fences.size()) {
+        GLenum r = glClientWaitSync(fences[done].sync, 0, 0);
+        if (r != GL_ALREADY_SIGNALED && r != GL_CONDITION_SATISFIED) break;
+        glDeleteSync(fences[done].sync);
+        ++done;
+    }
+    if (done) fences.erase(fences.begin(), fences.begin() + done);
 }
 
+size_t streamBuffer::reserve(size_t bytes, size_t align) {
+    if (align == 0) align = 1;
+    if (bytes > cap) grow(bytes * 2);
 
+    size_t offset = (head + align - 1) / align * align;
+    if (offset + bytes > cap) offset = 0; // wrap
+
+    retireSignaled();
+    // Never overwrite this frame's own data; growing beats stalling on last frame too
+    if (overlaps(frameRanges, offset, offset + bytes) ||
+        (!fences.empty() && overlaps(fences.back().ranges, offset, offset + bytes))) {
+        grow(cap * 2);
+        offset = 0;
+    } else {
+        // older frames: wait for the newest fence that covers the region (rarely blocks)
+        for (size_t i = fences.size(); i-- > 0;) {
+            if (!overlaps(fences[i].ranges, offset, offset + bytes)) continue;
+            for (;;) {
+                GLenum r = glClientWaitSync(fences[i].sync, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000);
+                if (r != GL_TIMEOUT_EXPIRED) break;
+            }
+            for (size_t j = 0; j <= i; ++j) glDeleteSync(fences[j].sync);
+            fences.erase(fences.begin(), fences.begin() + i + 1);
+            break;
+        }
+    }
+
+    head = offset + bytes;
+    frameRanges.push_back(Range{offset, offset + bytes});
+    return offset;
+}
+
+void* streamBuffer::map(size_t bytes, size_t align, size_t& offset) {
+    offset = reserve(bytes, align);
+    glState::bindBuffer(target, buffer);
+    void* ptr = glMapBufferRange(target, offset, bytes,
+                                 GL_MAP_WRITE_BIT | GL_MAP_UNSYNCHRONIZED_BIT | GL_MAP_INVALIDATE_RANGE_BIT);
+    mapped = ptr != nullptr;
+    if (!ptr) std::cerr << "streamBuffer: glMapBufferRange failed\n";
+    return ptr;
+}
+
+void streamBuffer::unmap() {
+    if (!mapped) return;
+    glState::bindBuffer(target, buffer);
+    if (glUnmapBuffer(target) == GL_FALSE) {
+        std::cerr << "streamBuffer: buffer contents lost during unmap\n";
+    }
+    mapped = false;
+    unbindPixelTarget();
+}
+
+void streamBuffer::unbindPixelTarget() {
+    // a bound pixel buffer turns the pointer of every later glTex(Sub)Image call into an
+    // offset into it: leave those targets at 0, users bind the ring only for their copy
+    if (target == GL_PIXEL_UNPACK_BUFFER || target == GL_PIXEL_PACK_BUFFER) glState::bindBuffer(target, 0);
+}
+
+size_t streamBuffer::upload(const void* data, size_t bytes, size_t align) {
+    size_t offset = 0;
+    void* dst = map(bytes, align, offset);
+    if (dst) {
+        memcpy(dst, data, bytes);
+        unmap();
+    }
+    return offset;
+}
+
+void streamBuffer::endFrame() {
+    if (frameRanges.empty()) return;
+    Fence f;
+    f.sync = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    f.ranges.swap(frameRanges);
+    fences.push_back(std::move(f));
+}
+
+// ---------------- retainedBuffer
+
+retainedBuffer::retainedBuffer(GLenum target) : target(target) {}
+
+retainedBuffer::~retainedBuffer() {
+    glState::deleteBuffer(buffer);
+}
+
+void retainedBuffer::bind() {
+    if (!buffer) glGenBuffers(1, &buffer);
+    glState::bindBuffer(target, buffer);
+}
+
+void retainedBuffer::upload(const void* data, size_t size) {
+    bind();
+    glBufferData(target, GLsizeiptr(size), data, GL_STATIC_DRAW);
+    bytes = size;
+}
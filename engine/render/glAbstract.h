@@ -1,6 +1,43 @@
 #pragma once
 #include <glad/glad.h>
 #include <SDL2/SDL.h>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Cache of the GL state the engine sets: program, VAO, buffer and texture bindings,
+// blend/depth state and int uniforms. Calls that would set what is already set are
+// skipped and counted. The state belongs to the context, so the one cache follows the
+// context to whichever thread has it current (see RenderThread).
+// Everything in engine/render binds through here; code that changes this state behind
+// its back must call glState::reset(), after which the next call of each kind is issued.
+namespace glState {
+    void useProgram(GLuint program);
+    void bindVertexArray(GLuint vao);
+    // GL_ELEMENT_ARRAY_BUFFER is VAO state and is tracked per VAO
+    void bindBuffer(GLenum target, GLuint buffer);
+    void activeTexture(GLenum unit);
+    void bindTexture(GLenum target, GLuint texture); // on the active unit
+    void enable(GLenum cap, bool on);
+    void blendFunc(GLenum src, GLenum dst);
+    void depthFunc(GLenum func);
+    void uniform1i(GLint location, GLint value);     // on the current program
+
+    // Attribute pointers are VAO state too. For a VAO whose pointers move between draws
+    // (GL 3.3 has no base instance), true when the bound VAO's were last pointed at
+    // `buffer` + `offset` (the caller then skips its `calls` setup calls); otherwise
+    // records them as pointed there and returns false.
+    bool attributesAt(GLuint buffer, size_t offset, unsigned calls);
+
+    // deleting through here forgets the names, so a reused name is bound again
+    void deleteBuffer(GLuint buffer);
+    void deleteTexture(GLuint texture);
+    void deleteVertexArray(GLuint vao);
+    void reset();
+
+    uint64_t issuedCalls();
+    uint64_t avoidedCalls();
+}
 
 
 class vao {
@@ -12,6 +49,8 @@ private:
     unsigned int VAO;
 };
 
+// Vertex buffer with the 8-float layout (pos3, normal3, uv2). The layout is recorded
+// once, in the VAO bound when the buffer is created; bind() only binds the buffer.
 class vbo {
 public:
     vbo(const float* vertices, size_t count);
@@ -24,3 +63,74 @@ private:
     GLsizei floatCount;
 };
 
+
+// Persistent ring buffer for data rewritten every frame. Uploads are written through
+// unsynchronized glMapBufferRange into the next free region, so the buffer is never
+// reallocated and the driver never has to stall on data the GPU is still reading.
+// endFrame() fences everything written that frame; a region is only reused once the
+// GPU has passed its fence (the buffer grows instead of waiting on recent frames).
+class streamBuffer {
+public:
+    explicit streamBuffer(size_t capacityBytes = size_t(4) << 20, GLenum target = GL_ARRAY_BUFFER);
+    ~streamBuffer();
+    streamBuffer(const streamBuffer&) = delete;
+    streamBuffer& operator=(const streamBuffer&) = delete;
+
+    void bind();
+    // bind and point attributes 0..2 at the 8-float vertex layout (pos3, normal3, uv2)
+    void bindVertexLayout();
+
+    // Map `bytes` of ring space aligned to `align`; returns the write pointer and the
+    // region's byte offset in `offset`. Call unmap() before drawing from it.
+    void* map(size_t bytes, size_t align, size_t& offset);
+    void unmap();
+    // map + memcpy + unmap; returns the byte offset of the copy
+    size_t upload(const void* data, size_t bytes, size_t align);
+
+    // fence this frame's regions; call once per frame after the last draw that reads them
+    void endFrame();
+
+    GLuint id() const { return buffer; }
+    size_t capacity() const { return cap; }
+
+private:
+    struct Range { size_t begin, end; };
+    struct Fence { GLsync sync; std::vector<Range> ranges; };
+
+    size_t reserve(size_t bytes, size_t align);
+    void grow(size_t minBytes);
+    void unbindPixelTarget();
+    void retireSignaled();
+    static bool overlaps(const std::vector<Range>& ranges, size_t begin, size_t end);
+
+    GLuint buffer = 0;
+    GLenum target = GL_ARRAY_BUFFER;
+    size_t cap = 0;
+    size_t head = 0;                  // next write position
+    std::vector<Range> frameRanges;   // written since the last endFrame()
+    std::vector<Fence> fences;        // oldest first
+    bool mapped = false;
+};
+
+// GPU buffer for data that is rebuilt rarely (static geometry). upload() re-specifies the
+// store, so a rebuild never waits on draws that still read the previous contents.
+// The GL name is created on the first bind/upload, so owners can construct one on a
+// thread without the context.
+class retainedBuffer {
+public:
+    explicit retainedBuffer(GLenum target = GL_ARRAY_BUFFER);
+    ~retainedBuffer();
+    retainedBuffer(const retainedBuffer&) = delete;
+    retainedBuffer& operator=(const retainedBuffer&) = delete;
+
+    void bind();
+    void upload(const void* data, size_t bytes);
+
+    GLuint id() const { return buffer; }
+    size_t size() const { return bytes; }
+
+private:
+    GLuint buffer = 0;
+    GLenum target = GL_ARRAY_BUFFER;
+    size_t bytes = 0;
+};
@@ -0,0 +1,68 @@
+#include "engine/render/image_loader.h"
+#include "incl/stb_image.h"
+#include <algorithm>
+
+ImageLoader::ImageLoader(unsigned workers) : workerCount(workers) {
+    if (workerCount == 0) {
+        unsigned hw = std::thread::hardware_concurrency();
+        workerCount = std::min(std::max(hw > 1 ? hw - 1 : 1u, 1u), 4u);
+    }
+}
+
+ImageLoader::~ImageLoader() {
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        stopping = true;
+        queue.clear();
+    }
+    wake.notify_all();
+    for (auto &t : workers) t.join();
+    for (auto &d : done) {
+        if (d.pixels) stbi_image_free(d.pixels);
+    }
+}
+
+void ImageLoader::request(const std::string& path) {
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        queue.push_back(path);
+        ++outstanding;
+        if (workers.empty()) {
+            for (unsigned i = 0; i < workerCount; ++i) workers.emplace_back(&ImageLoader::work, this);
+        }
+    }
+    wake.notify_one();
+}
+
+size_t ImageLoader::collect(std::vector<Decoded>& out) {
+    std::lock_guard<std::mutex> lock(mtx);
+    size_t n = done.size();
+    if (n == 0) return 0;
+    out.insert(out.end(), std::make_move_iterator(done.begin()), std::make_move_iterator(done.end()));
+    done.clear();
+    outstanding -= n;
+    return n;
+}
+
+size_t ImageLoader::inFlight() const {
+    std::lock_guard<std::mutex> lock(mtx);
+    return outstanding;
+}
+
+void ImageLoader::work() {
+    for (;;) {
+        Decoded d;
+        {
+            std::unique_lock<std::mutex> lock(mtx);
+            wake.wait(lock, [this]{ return stopping || !queue.empty(); });
+            if (stopping) return;
+            d.path = std::move(queue.front());
+            queue.pop_front();
+        }
+        // the slow part runs unlocked; the flip setting is the global one the engine set
+        int channels = 0;
+        d.pixels = stbi_load(d.path.c_str(), &d.w, &d.h, &channels, 4);
+        std::lock_guard<std::mutex> lock(mtx);
+        done.push_back(std::move(d));
+    }
+}
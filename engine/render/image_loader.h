@@ -0,0 +1,51 @@
+#ifndef IMAGE_LOADER_H
+#define IMAGE_LOADER_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Decodes image files (stbi_load, RGBA) on worker threads.
+//
+// request() queues a path and returns at once; collect() hands over whatever has
+// finished since the last call, without waiting. Workers start on the first request.
+// Nothing here touches GL or the caller's data, so results are applied by the layer
+// that asked, in its prepare() (RenderLayer::collectDecodedImages).
+class ImageLoader {
+public:
+    struct Decoded {
+        std::string path;
+        int w = 0, h = 0;
+        unsigned char* pixels = nullptr; // from stbi_load, owned by the receiver; nullptr: failed
+    };
+
+    // 0 workers: one less than the hardware threads, between 1 and 4
+    explicit ImageLoader(unsigned workers = 0);
+    ~ImageLoader(); // stops the workers and frees results nobody collected
+    ImageLoader(const ImageLoader&) = delete;
+    ImageLoader& operator=(const ImageLoader&) = delete;
+
+    void request(const std::string& path);
+    // append finished decodes to `out`; returns how many
+    size_t collect(std::vector<Decoded>& out);
+    // requested and not collected yet
+    size_t inFlight() const;
+
+private:
+    void work();
+
+    unsigned workerCount;
+    std::vector<std::thread> workers;
+    mutable std::mutex mtx;
+    std::condition_variable wake;
+    std::deque<std::string> queue;
+    std::vector<Decoded> done;
+    size_t outstanding = 0;
+    bool stopping = false;
+};
+
+#endif // IMAGE_LOADER_H
@@ -0,0 +1,85 @@
+#ifndef ISO_PROJECTION_H
+#define ISO_PROJECTION_H
+
+#include "engine/enginem.h"
+
+// World -> virtual-resolution screen projection used for drawing and picking, so both
+// agree to the pixel. Sprites are projected on the GPU from the same values (see Block
+// and default.vs); on the CPU it serves culling and picking. A sprite at world (x, y, z)
+// is a SPRITE_W x SPRITE_H quad whose top-left corner sits at (spriteX, spriteY).
+struct IsoProjection {
+    static const int SPRITE_W = 64;
+    static const int SPRITE_H = 64;
+
+    float halfW = 0.0f;   // screen x per world unit along (x - y)
+    float diagH = 0.0f;   // screen y per world unit along (x + y)
+    float heightH = 0.0f; // screen y per world unit of z
+    float offsetX = 0.0f, offsetY = 0.0f;
+    float camX = 0.0f, camY = 0.0f, camZ = 0.0f;
+
+    // Projection for the engine's current tile size, virtual resolution and camera
+    static IsoProjection fromEngine(const Engine* engine) {
+        IsoProjection p;
+        const int TILE_W = engine->tile_width;
+        const int TILE_H = engine->tile_height;
+        p.halfW = TILE_W / 2.0f;
+        p.diagH = TILE_W / 6.4f;
+        p.heightH = TILE_H * 0.66f;
+        p.offsetX = float(engine->virt_sx / 2);
+        p.offsetY = float(engine->virt_sy / 2);
+        if (engine->sceneMgr && engine->sceneMgr->isCamera && engine->sceneMgr->camera) {
+            p.camX = engine->sceneMgr->camera->x;
+            p.camY = engine->sceneMgr->camera->y;
+            p.camZ = engine->sceneMgr->camera->z;
+        }
+        return p;
+    }
+
+    float screenX(float wx, float wy) const {
+        return ((wx - camX) - (wy - camY)) * halfW + offsetX;
+    }
+    float screenY(float wx, float wy, float wz) const {
+        return ((wx - camX) + (wy - camY)) * diagH - ((wz - camZ) * heightH) + offsetY;
+    }
+    int spriteX(float wx, float wy) const { return int(screenX(wx, wy)); }
+    int spriteY(float wx, float wy, float wz) const { return int(screenY(wx, wy, wz)); }
+
+    // std140 layout of the `IsoView` uniform block in default.vs (binding point 0)
+    struct Block {
+        float proj[4];   // halfW, diagH, heightH, 0
+        float camera[4]; // camX, camY, camZ, 0
+        float screen[4]; // offsetX, offsetY, virtual width, virtual height
+        float sprite[4]; // SPRITE_W, SPRITE_H, 0, 0
+    };
+    Block block(int virtW, int virtH) const {
+        return Block{
+            { halfW, diagH, heightH, 0.0f },
+            { camX, camY, camZ, 0.0f },
+            { offsetX, offsetY, float(virtW), float(virtH) },
+            { float(SPRITE_W), float(SPRITE_H), 0.0f, 0.0f },
+        };
+    }
+
+    // World-space box [x0, x1] x [y0, y1] holding every position with z in [wz0, wz1]
+    // whose sprite touches the screen rect [sx0, sx1] x [sy0, sy1]. Padded by a pixel
+    // for truncation. The exact region is a diamond; the box is its bounding box.
+    void rectBounds(float sx0, float sy0, float sx1, float sy1, float wz0, float wz1,
+                    float& x0, float& y0, float& x1, float& y1) const {
+        // (x - y) and (x + y) ranges that put the sprite's corner within reach of the rect
+        float u0 = (sx0 - SPRITE_W - 1.0f - offsetX) / halfW;
+        float u1 = (sx1 + 1.0f - offsetX) / halfW;
+        float v0 = (sy0 - SPRITE_H - 1.0f - offsetY + (wz0 - camZ) * heightH) / diagH;
+        float v1 = (sy1 + 1.0f - offsetY + (wz1 - camZ) * heightH) / diagH;
+        x0 = (u0 + v0) * 0.5f + camX;
+        x1 = (u1 + v1) * 0.5f + camX;
+        y0 = (v0 - u1) * 0.5f + camY;
+        y1 = (v1 - u0) * 0.5f + camY;
+    }
+    // same for a single pixel (picking)
+    void coveringBounds(float px, float py, float wz0, float wz1,
+                        float& x0, float& y0, float& x1, float& y1) const {
+        rectBounds(px, py, px, py, wz0, wz1, x0, y0, x1, y1);
+    }
+};
+
+#endif // ISO_PROJECTION_H
@@ -1,37 +1,410 @@
 #include "engine/render/isometric_layer.h"
 #include "engine/render/renderm.h"
+#include "engine/render/sprite_batch.h"
+#include "engine/tile/tilemap_oclass.h"
 #include <algorithm>
+#include <cmath>
 #include <iostream>
+#include <iterator>
 
 IsometricLayer::IsometricLayer(Engine* eng, std::vector<std::unique_ptr<Object>>* reg, int atlasSize)
     : RenderLayer(eng, atlasSize), registry(reg) {}
 
+uint64_t IsometricLayer::objectKey(const Object* obj) {
+    return PaintKey::make(obj->x, obj->y, obj->z, PaintKey::OBJECT);
+}
+
+// -----------------------------
+// static / dynamic classification
+
+void IsometricLayer::track(Object* obj) {
+    if (!obj || obj->id == 0 || obj->obj_class == "ui") return;
+    if (obj->obj_class == "tilemap") {
+        // placed into chunks (and its palette textures loaded) by syncTilemap
+        if (std::find(tilemapIds.begin(), tilemapIds.end(), obj->id) == tilemapIds.end()) tilemapIds.push_back(obj->id);
+        return;
+    }
+    ensureImageLoaded(obj->texture); // may be empty (placeholder)
+    if (obj->isStatic) {
+        addStatic(obj);
+    } else {
+        dynamicIds[obj->id] = frame;
+        reorder(obj->id);
+    }
+}
+
+void IsometricLayer::touch(Object* obj) {
+    if (!obj || obj->id == 0 || obj->obj_class == "ui" || obj->obj_class == "tilemap") return; // tilemaps: syncTilemap
+    ensureImageLoaded(obj->texture);
+    if (staticChunk.count(obj->id)) {
+        removeStatic(obj->id);
+        if (obj->isStatic) { addStatic(obj); return; } // flagged static: stays, possibly in another chunk
+    }
+    dynamicIds[obj->id] = frame;
+    reorder(obj->id);
+}
+
+void IsometricLayer::forget(int id) {
+    removeStatic(id);
+    if (dynamicIds.erase(id)) reorder(id);
+    auto it = std::find(tilemapIds.begin(), tilemapIds.end(), id);
+    if (it != tilemapIds.end()) {
+        tilemapIds.erase(it);
+        detachTilemap(id);
+        mapStates.erase(id);
+    }
+}
+
+void IsometricLayer::addStatic(Object* obj) {
+    ChunkId cid = chunkOfKey(objectKey(obj));
+    Chunk &chunk = chunks[cid];
+    chunk.objects.push_back(obj->id);
+    chunk.dirty = true;
+    staticChunk[obj->id] = cid;
+}
+
+void IsometricLayer::removeStatic(int id) {
+    auto sc = staticChunk.find(id);
+    if (sc == staticChunk.end()) return;
+    auto it = chunks.find(sc->second);
+    staticChunk.erase(sc);
+    if (it == chunks.end()) return;
+    auto &objs = it->second.objects;
+    auto o = std::find(objs.begin(), objs.end(), id);
+    if (o != objs.end()) {
+        *o = objs.back();
+        objs.pop_back();
+    }
+    it->second.dirty = true;
+    dropIfEmpty(it);
+}
+
+void IsometricLayer::dropIfEmpty(std::map<ChunkId, Chunk>::iterator it) {
+    if (!it->second.objects.empty() || !it->second.tilemaps.empty()) return;
+    retireChunk(it->second);
+    chunks.erase(it);
+}
+
+void IsometricLayer::retireChunk(Chunk& chunk) {
+    releaseChunkTextures(chunk);
+    // the last reference goes with the command, where GL is current
+    if (chunk.vbo) gl([vbo = std::move(chunk.vbo)] {});
+}
+
+void IsometricLayer::releaseChunkTextures(Chunk& chunk) {
+    for (const std::string &t : chunk.textures) releaseTexture(t);
+    chunk.textures.clear();
+}
+
+void IsometricLayer::detachTilemap(int id) {
+    auto st = mapStates.find(id);
+    if (st == mapStates.end()) return;
+    for (ChunkId cid : st->second.chunks) {
+        auto it = chunks.find(cid);
+        if (it == chunks.end()) continue;
+        auto &maps = it->second.tilemaps;
+        maps.erase(std::remove(maps.begin(), maps.end(), id), maps.end());
+        it->second.dirty = true;
+        dropIfEmpty(it);
+    }
+    st->second.chunks.clear();
+}
+
+void IsometricLayer::syncTilemap(TileMap_OBJ* map) {
+    // Palette entries may be added after instantiation; newly resolved textures change
+    // how existing cells look, so they count as a move
+    bool paletteChanged = false;
+    if (!map->paletteResolved() && engine && engine->objMgr) {
+        map->resolvePalette(*engine->objMgr);
+        paletteChanged = true;
+    }
+    auto found = mapStates.find(map->id);
+    if (found != mapStates.end() && !paletteChanged && found->second.revision == map->getRevision() &&
+        found->second.x == map->x && found->second.y == map->y && found->second.z == map->z &&
+        found->second.invis == map->invis) return;
+
+    MapState &st = mapStates[map->id];
+    for (size_t i = 1; i <= map->getPalette().size(); ++i) ensureImageLoaded(map->textureFor(TileMap_OBJ::TileId(i)));
+
+    // Same placement and size: only chunks whose tiles changed need rebuilding
+    bool placed = found != mapStates.end() && !paletteChanged && st.x == map->x && st.y == map->y && st.z == map->z &&
+                  st.invis == map->invis && st.width == map->getWidth() && st.height == map->getHeight();
+    if (!placed) detachTilemap(map->id);
+
+    std::vector<uint32_t> revs(size_t(map->chunksX()) * size_t(map->chunksY()), 0);
+    for (int mcy = 0; mcy < map->chunksY(); ++mcy) {
+        for (int mcx = 0; mcx < map->chunksX(); ++mcx) {
+            size_t i = size_t(mcy) * map->chunksX() + mcx;
+            revs[i] = map->getChunkRevision(mcx, mcy);
+            bool changed = !placed || revs[i] != st.chunkRevisions[i];
+            if (!changed || map->invis || map->getChunk(mcx, mcy).empty()) continue;
+
+            // a map chunk overlaps up to 2x2 world chunks unless the map origin is aligned
+            float x0 = map->x + mcx * TileMap_OBJ::CHUNK, y0 = map->y + mcy * TileMap_OBJ::CHUNK;
+            int wcx0 = chunkOf(x0), wcx1 = chunkOf(x0 + TileMap_OBJ::CHUNK - 1);
+            int wcy0 = chunkOf(y0), wcy1 = chunkOf(y0 + TileMap_OBJ::CHUNK - 1);
+            for (int wcy = wcy0; wcy <= wcy1; ++wcy) {
+                for (int wcx = wcx0; wcx <= wcx1; ++wcx) {
+                    ChunkId cid = PaintKey::chunk(map->z, wcy, wcx);
+                    Chunk &chunk = chunks[cid];
+                    chunk.dirty = true;
+                    if (std::find(chunk.tilemaps.begin(), chunk.tilemaps.end(), map->id) == chunk.tilemaps.end()) {
+                        chunk.tilemaps.push_back(map->id);
+                        st.chunks.push_back(cid);
+                    }
+                }
+            }
+        }
+    }
+    st.x = map->x; st.y = map->y; st.z = map->z;
+    st.width = map->getWidth(); st.height = map->getHeight();
+    st.invis = map->invis;
+    st.revision = map->getRevision();
+    st.chunkRevisions.swap(revs);
+}
+
+void IsometricLayer::resync() {
+    for (auto &c : chunks) retireChunk(c.second);
+    chunks.clear();
+    staticChunk.clear();
+    dynamicIds.clear();
+    dynamicOrder.clear(); // pointers may be stale after a missed commit
+    orderColumnsStale = true;
+    reorderIds.clear();
+    tilemapIds.clear();
+    mapStates.clear();
+    for (auto &objPtr : *registry) track(objPtr.get());
+}
+
+void IsometricLayer::updateOrder() {
+    if (reorderIds.empty()) return;
+    orderColumnsStale = true;
+    const objManager &mgr = *engine->objMgr;
+    auto byPaint = [](const DynamicEntry& a, const DynamicEntry& b) { return a.key < b.key; };
+    auto entryFor = [](Object* obj) { return DynamicEntry{objectKey(obj), obj->x, obj->y, obj->z, obj, obj->id}; };
+
+    // Most of the list changed: cheaper to sort it from scratch
+    if (reorderIds.size() * 2 > dynamicOrder.size()) {
+        dynamicOrder.clear();
+        for (const auto &d : dynamicIds) {
+            if (Object* obj = mgr.findById(d.first)) dynamicOrder.push_back(entryFor(obj));
+        }
+        sortByKey(dynamicOrder, orderMerged);
+        reorderIds.clear();
+        ++fullSorts;
+        return;
+    }
+
+    // Otherwise drop the changed entries, sort them on their own and merge them back
+    orderDelta.clear();
+    for (int id : reorderIds) {
+        if (!dynamicIds.count(id)) continue; // destroyed or promoted to static
+        if (Object* obj = mgr.findById(id)) orderDelta.push_back(entryFor(obj));
+    }
+    dynamicOrder.erase(std::remove_if(dynamicOrder.begin(), dynamicOrder.end(),
+        [&](const DynamicEntry& e){ return reorderIds.count(e.id) != 0; }), dynamicOrder.end());
+    sortByKey(orderDelta, orderMerged);
+    orderMerged.clear();
+    orderMerged.reserve(dynamicOrder.size() + orderDelta.size());
+    std::merge(dynamicOrder.begin(), dynamicOrder.end(), orderDelta.begin(), orderDelta.end(),
+               std::back_inserter(orderMerged), byPaint);
+    dynamicOrder.swap(orderMerged);
+    reorderIds.clear();
+}
+
 void IsometricLayer::prepare(renderPipeline* pipeline) {
-    // ensure all textures used by objects are loaded (create placeholder if missing)
-    if (!registry || registry->empty()) return;
-    for (auto &objPtr : *registry) {
-        if (!objPtr) continue;
-        if (objPtr->id == 0) continue;
-        const std::string &path = objPtr->texture; // may be empty
-        ensureImageLoaded(path);
+    if (!registry || !engine || !engine->objMgr) return;
+    objManager &mgr = *engine->objMgr;
+    ++frame;
+
+    // Follow the change sets; a skipped commit (or the first frame) means a full resync
+    uint64_t commit = mgr.commitSerial();
+    if (!synced || commit != lastCommit + 1) {
+        if (!synced || commit != lastCommit) resync();
+        synced = true;
+    } else {
+        const auto &ch = mgr.getChanges();
+        for (int id : ch.destroyed) forget(id);
+        for (Object* obj : ch.spawned) track(obj);
+        for (Object* obj : ch.moved) touch(obj);
+        for (Object* obj : ch.retextured) touch(obj);
+    }
+    lastCommit = commit;
+
+    // Tilemap edits don't go through change tracking; syncTilemap compares revisions
+    for (int id : tilemapIds) {
+        Object* obj = mgr.findById(id);
+        if (obj) syncTilemap(static_cast<TileMap_OBJ*>(obj));
+    }
+
+    // Objects that stayed put long enough join the static chunks
+    for (auto it = dynamicIds.begin(); it != dynamicIds.end();) {
+        Object* obj = frame - it->second >= SETTLE_FRAMES ? mgr.findById(it->first) : nullptr;
+        if (!obj) { ++it; continue; }
+        addStatic(obj);
+        reorder(it->first);
+        it = dynamicIds.erase(it);
     }
+    updateOrder();
+
     // let base class ensure atlas is built
     RenderLayer::prepare(pipeline);
+    if (atlasVersion != chunkAtlasVersion) {
+        // UVs moved: every chunk's instances are stale
+        chunkAtlasVersion = atlasVersion;
+        for (auto &c : chunks) c.second.dirty = true;
+        chunkPlaceholderVersion = placeholderVersion;
+    } else if (placeholderVersion != chunkPlaceholderVersion) {
+        // decoded images reached the atlas: only chunks drawn with the placeholder change
+        chunkPlaceholderVersion = placeholderVersion;
+        for (auto &c : chunks) {
+            if (c.second.placeholder) c.second.dirty = true;
+        }
+    }
 }
 
-void IsometricLayer::render(renderPipeline* pipeline) {
-    if (!registry || registry->empty()) return;
+// -----------------------------
+// instances
 
-    // Compute camera rectangle (full screen for now, modify if using camera offset)
-    struct CameraRect { int x0, y0, x1, y1; };
-    CameraRect camRect{ 0, 0, engine->virt_sx, engine->virt_sy };
+bool IsometricLayer::writeInstances(const std::vector<Sprite>& sorted, SpriteInstance* inst) {
+    auto unorm16 = [](float v) { return uint16_t(std::min(std::max(v, 0.0f), 1.0f) * 65535.0f + 0.5f); };
+    const std::string* lastTex = nullptr; // neighbours in painter order often share a texture
+    uint16_t rect[4] = {0, 0, 65535, 65535};
+    uint16_t crop[4] = {0, 0, 65535, 65535};
+    uint32_t page = 0;
+    bool placeholder = false;
+    for (const auto& spr : sorted) {
+        if (spr.texture != lastTex) {
+            lastTex = spr.texture;
+            SubTexture uv;
+            if (!lookupSubTexture(*spr.texture, uv)) placeholder = true; // still decoding
+            rect[0] = unorm16(uv.u0); rect[1] = unorm16(uv.v0);
+            rect[2] = unorm16(uv.u1); rect[3] = unorm16(uv.v1);
+            page = uint32_t(uv.page);
+            crop[0] = unorm16(uv.x0); crop[1] = unorm16(uv.y0);
+            crop[2] = unorm16(uv.x1); crop[3] = unorm16(uv.y1);
+        }
+        SpriteInstance &si = *inst++;
+        si.x = spr.x;
+        si.y = spr.y;
+        si.z = spr.z;
+        si.page = page;
+        si.u0 = rect[0]; si.v0 = rect[1]; si.u1 = rect[2]; si.v1 = rect[3];
+        si.tint = 0xFFFFFFFFu;
+        si.crop[0] = crop[0]; si.crop[1] = crop[1]; si.crop[2] = crop[2]; si.crop[3] = crop[3];
+    }
+    return placeholder;
+}
+
+void IsometricLayer::rebuildChunk(ChunkId cid, Chunk& chunk) {
+    chunk.dirty = false;
+    const objManager &mgr = *engine->objMgr;
+    const float cx0 = float(PaintKey::chunkCol(cid) * CHUNK), cy0 = float(PaintKey::chunkRow(cid) * CHUNK);
+
+    std::vector<Sprite> &sprites = chunkSprites;
+    sprites.clear();
+    for (int id : chunk.objects) {
+        Object* obj = mgr.findById(id);
+        if (!obj || obj->invis) continue;
+        sprites.push_back(Sprite{objectKey(obj), obj->x, obj->y, obj->z, &obj->texture});
+    }
+    for (int id : chunk.tilemaps) {
+        auto *map = static_cast<const TileMap_OBJ*>(mgr.findById(id));
+        if (!map || map->invis) continue;
+        // cells of the map whose world position falls inside this chunk
+        int tx0 = std::max(0, int(std::floor(cx0 - map->x)) - 1), tx1 = std::min(map->getWidth() - 1, int(std::ceil(cx0 + CHUNK - map->x)));
+        int ty0 = std::max(0, int(std::floor(cy0 - map->y)) - 1), ty1 = std::min(map->getHeight() - 1, int(std::ceil(cy0 + CHUNK - map->y)));
+        for (int ty = ty0; ty <= ty1; ++ty) {
+            float wy = map->y + ty;
+            for (int tx = tx0; tx <= tx1; ++tx) {
+                TileMap_OBJ::TileId tid = map->getTile(tx, ty);
+                if (!tid) continue;
+                float wx = map->x + tx;
+                uint64_t key = PaintKey::make(wx, wy, map->z, PaintKey::TILE);
+                if (chunkOfKey(key) != cid) continue;
+                sprites.push_back(Sprite{key, wx, wy, map->z, &map->textureFor(tid)});
+            }
+        }
+    }
+    sortByKey(sprites, spriteScratch);
+
+    auto instances = std::make_shared<std::vector<SpriteInstance>>(sprites.size());
+    chunk.placeholder = writeInstances(sprites, instances->data());
+
+    // the chunk's instances keep these images' rects: hold them resident until the
+    // next rebuild (acquire before release so shared images never drop to zero)
+    std::vector<std::string> &used = chunkTextures;
+    used.clear();
+    const std::string* last = nullptr;
+    for (const auto &spr : sprites) {
+        if (spr.texture == last) continue;
+        last = spr.texture;
+        used.push_back(*spr.texture);
+    }
+    std::sort(used.begin(), used.end());
+    used.erase(std::unique(used.begin(), used.end()), used.end());
+    for (const std::string &t : used) acquireTexture(t);
+    releaseChunkTextures(chunk);
+    chunk.textures.swap(used);
+    chunk.keys.resize(sprites.size());
+    for (size_t i = 0; i < sprites.size(); ++i) chunk.keys[i] = sprites[i].key;
+    if (!chunk.vbo) chunk.vbo = std::make_shared<retainedBuffer>();
+    gl([vbo = chunk.vbo, instances] { vbo->upload(instances->data(), instances->size() * sizeof(SpriteInstance)); });
+}
+
+void IsometricLayer::collectVisibleChunks(const IsoProjection& proj) {
+    visible.clear();
+    chunksTested = 0;
+    const int Z_SHIFT = 2 * PaintKey::CHUNK_BITS;     // chunk id = (z, row, column)
+    const int LIMIT = 1 << (PaintKey::CHUNK_BITS - 1); // chunk coordinates stay in [-LIMIT, LIMIT)
+    auto chunkRange = [&](float v) {
+        float c = std::floor(v / float(CHUNK));
+        return int(std::min(std::max(c, -float(LIMIT)), float(LIMIT - 1)));
+    };
+
+    // one z level at a time, in painter order
+    for (auto level = chunks.begin(); level != chunks.end();) {
+        const uint64_t zBits = level->first >> Z_SHIFT;
+        const float z0 = PaintKey::chunkZ(level->first), z1 = z0 + 1.0f / PaintKey::STEPS;
+        float x0, y0, x1, y1;
+        proj.rectBounds(0.0f, 0.0f, float(engine->virt_sx), float(engine->virt_sy), z0, z1, x0, y0, x1, y1);
+        const int c0 = chunkRange(x0), c1 = chunkRange(x1);
+        const int r0 = chunkRange(y0), r1 = chunkRange(y1);
+
+        // rows are contiguous in the map, so each row in range is one ordered scan
+        for (int r = r0; r <= r1; ++r) {
+            const ChunkId last = PaintKey::chunk(z0, r, c1);
+            for (auto it = chunks.lower_bound(PaintKey::chunk(z0, r, c0)); it != chunks.end() && it->first <= last; ++it) {
+                ++chunksTested;
+                if (!chunkVisible(proj, it->first)) continue; // box corners outside the diamond
+                if (it->second.dirty) rebuildChunk(it->first, it->second);
+                if (!it->second.keys.empty()) visible.push_back(&it->second);
+            }
+        }
+        level = chunks.lower_bound((zBits + 1) << Z_SHIFT);
+    }
+}
+
+bool IsometricLayer::chunkVisible(const IsoProjection& proj, ChunkId cid) const {
+    // sprites anchored in [x0, x1) x [y0, y1) x [z0, z1); screen x grows with x - y,
+    // screen y with x + y and shrinks with z
+    float x0 = float(PaintKey::chunkCol(cid) * CHUNK), x1 = x0 + CHUNK;
+    float y0 = float(PaintKey::chunkRow(cid) * CHUNK), y1 = y0 + CHUNK;
+    float z0 = PaintKey::chunkZ(cid), z1 = z0 + 1.0f / PaintKey::STEPS;
+    float left = proj.screenX(x0, y1), right = proj.screenX(x1, y0) + IsoProjection::SPRITE_W;
+    float top = proj.screenY(x0, y0, z1), bottom = proj.screenY(x1, y1, z0) + IsoProjection::SPRITE_H;
+    return !(right < 0.0f || left > float(engine->virt_sx) || bottom < 0.0f || top > float(engine->virt_sy));
+}
+
+void IsometricLayer::render(renderPipeline* pipeline) {
+    if (!registry || registry->empty() || !engine || !engine->objMgr) return;
 
     // Debug: print a single-frame summary if something looks wrong (helps track missing textures)
     static bool debugPrinted = false;
     if (!debugPrinted) {
         debugPrinted = true;
         std::cout << "IsometricLayer: debug: registry size=" << (registry ? registry->size() : 0)
-                  << " atlasEntries=" << atlasMap.size() << " atlasBuilt=" << atlasBuilt << " atlasTex=" << atlasTex << "\n";
+                  << " atlasEntries=" << atlasMap.size() << " atlasBuilt=" << atlasBuilt << "\n";
         int count = 0;
         for (auto &objPtr : *registry) {
             if (!objPtr) continue;
@@ -46,68 +419,181 @@ void IsometricLayer::render(renderPipeline* pipeline) {
         }
     }
 
-    // Sort objects in isometric order (include objects without texture; they will use a placeholder)
-    std::vector<Object*> sorted;
-    for (auto& obj : *registry) if (obj && obj->id != 0 && !obj->invis && obj->obj_class != "ui") sorted.push_back(obj.get());
-    std::sort(sorted.begin(), sorted.end(), [](Object* a, Object* b){
-        if (a->z != b->z) return a->z < b->z;
-        if (a->y != b->y) return a->y < b->y;
-        return a->x < b->x;
-    });
+    // Same projection as the vertex shader, so culling agrees with what is drawn
+    const IsoProjection proj = IsoProjection::fromEngine(engine);
 
-    // Build worldVerts with culling
-    std::vector<float> worldVerts;
-    worldVerts.reserve(sorted.size() * 6 * 8);
-
-    const int TILE_W = engine->tile_width;
-    const int TILE_H = engine->tile_height;
-    const int OFFSET_X = engine->virt_sx/2;
-    const int OFFSET_Y = engine->virt_sy/2;
-
-    auto isObjectOnScreen = [&](const Object* obj) {
-        // account for camera offset if present
-        float camX = 0.0f, camY = 0.0f, camZ = 0.0f;
-        if (engine && engine->sceneMgr && engine->sceneMgr->isCamera && engine->sceneMgr->camera) {
-            camX = engine->sceneMgr->camera->x;
-            camY = engine->sceneMgr->camera->y;
-            camZ = engine->sceneMgr->camera->z;
+    // Dynamic sprites: the persistent order is already sorted, so only cull it, in one
+    // batched pass over its position columns (include objects without texture; they
+    // will use a placeholder)
+    if (orderColumnsStale) {
+        orderColumnsStale = false;
+        size_t n = dynamicOrder.size();
+        orderX.resize(n); orderY.resize(n); orderZ.resize(n);
+        for (size_t i = 0; i < n; ++i) {
+            orderX[i] = dynamicOrder[i].x;
+            orderY[i] = dynamicOrder[i].y;
+            orderZ[i] = dynamicOrder[i].z;
         }
+    }
+    onScreen.resize(dynamicOrder.size());
+    size_t shown = SpriteBatch::cull(proj, orderX.data(), orderY.data(), orderZ.data(), dynamicOrder.size(),
+                                     engine->virt_sx, engine->virt_sy, onScreen.data());
+    sprites.clear();
+    for (size_t i = 0; i < shown; ++i) {
+        const DynamicEntry &e = dynamicOrder[onScreen[i]];
+        if (e.obj->invis) continue;
+        sprites.push_back(Sprite{e.key, e.x, e.y, e.z, &e.obj->texture});
+    }
 
-        float ox = obj->x - camX;
-        float oy = obj->y - camY;
-        float oz = obj->z - camZ;
+    // Visible chunks in painter order; dirty ones are rebuilt only once they are seen
+    collectVisibleChunks(proj);
 
-        float screenX = (ox - oy) * (TILE_W / 2.0f) + OFFSET_X;
-        // Match the render projection constants so culling uses the same Y projection
-        float screenY = (ox + oy) * 10 - oz * 42 + OFFSET_Y;
+    if (sprites.empty() && visible.empty()) return;
 
-        int left   = int(screenX);
-        int right  = int(screenX + TILE_W);
-        int top    = int(screenY);
-        int bottom = int(screenY + TILE_H);
+    // Dynamic instances go straight into the stream ring (or the frame packet). Positions
+    // stay in world space; default.vs projects them with the pipeline's IsoView block.
+    StreamRef dyn;
+    if (!sprites.empty()) {
+        auto *inst = static_cast<SpriteInstance*>(pipeline->streamAlloc(sprites.size() * sizeof(SpriteInstance), sizeof(SpriteInstance), dyn));
+        if (!inst) return;
+        writeInstances(sprites, inst);
+        pipeline->streamDone();
+    }
 
-        return !(right < camRect.x0 || left > camRect.x1 ||
-                 bottom < camRect.y0 || top > camRect.y1);
+    // Draw runs in painter order: a chunk's buffer (null: the dynamic instances) and a range
+    const size_t STRIDE = sizeof(SpriteInstance);
+    struct DrawRun { std::shared_ptr<retainedBuffer> buffer; size_t offset, count; };
+    std::vector<DrawRun> runs;
+    auto drawRun = [&](const std::shared_ptr<retainedBuffer>& buffer, size_t offset, size_t count) {
+        if (count > 0) runs.push_back(DrawRun{buffer, offset, count});
+    };
+    // dynamic sprites from d up to (not including) the first whose key isn't below `limit`
+    size_t d = 0;
+    auto drawDynamicBefore = [&](const uint64_t* limit) {
+        size_t e = d;
+        while (e < sprites.size() && (!limit || sprites[e].key < *limit)) ++e;
+        drawRun(nullptr, d * STRIDE, e - d);
+        d = e;
     };
 
-    int index = 0;
-    for (auto* obj : sorted) {
-        if (!isObjectOnScreen(obj)) continue; // skip off-screen objects
+    // Merge in painter order: each chunk is one draw, split only where dynamic sprites
+    // sort into it (they go after static sprites with equal keys)
+    for (Chunk* chunk : visible) {
+        const auto &keys = chunk->keys;
+        drawDynamicBefore(&keys.front());
+        size_t s = 0;
+        while (d < sprites.size() && sprites[d].key < keys.back()) {
+            auto at = std::upper_bound(keys.begin() + s, keys.end(), sprites[d].key);
+            size_t pos = size_t(at - keys.begin()); // < size: sprites[d] sorts before the last key
+            drawRun(chunk->vbo, s * STRIDE, pos - s);
+            s = pos;
+            drawDynamicBefore(&keys[s]);
+        }
+        drawRun(chunk->vbo, s * STRIDE, keys.size() - s);
+    }
+    drawDynamicBefore(nullptr);
+
+    // Draw: four corners per instance from the shared quad indices, expanded in default.vs
+    gl([this, pipeline, dyn, runs = std::move(runs)] {
+        pipeline->useShader(SPRITE_INSTANCES);
+        glState::activeTexture(GL_TEXTURE0);
+        glState::bindTexture(GL_TEXTURE_2D_ARRAY, atlasTex);
+        const size_t dynOffset = pipeline->streamOffset(dyn);
+        for (const DrawRun &r : runs) {
+            if (r.buffer) pipeline->bindSpriteInstances(r.buffer->id(), r.offset);
+            else pipeline->bindSpriteInstances(pipeline->streamVBO->id(), dynOffset + r.offset);
+            glDrawElementsInstanced(GL_TRIANGLES, 6, GL_UNSIGNED_SHORT, nullptr, (GLsizei)r.count);
+        }
+    });
+}
+
+bool IsometricLayer::spriteCovers(const IsoProjection& proj, float wx, float wy, float wz,
+                                  const std::string& texture, float px, float py) const {
+    int lx = int(std::floor(px)) - proj.spriteX(wx, wy);
+    int ly = int(std::floor(py)) - proj.spriteY(wx, wy, wz);
+    if (lx < 0 || ly < 0 || lx >= IsoProjection::SPRITE_W || ly >= IsoProjection::SPRITE_H) return false;
+
+    auto it = rawImages.find(texture);
+    if (it == rawImages.end()) return true; // no image data: treat as opaque
+    const RawImage &ri = it->second;
+
+    // Same mapping as quadTemplate: u runs 1 -> 0 left to right, v runs 1 -> 0 top to
+    // bottom, and images are stored bottom-up (flipped on load)
+    int col = int((1.0f - (lx + 0.5f) / IsoProjection::SPRITE_W) * ri.w);
+    int row = int((1.0f - (ly + 0.5f) / IsoProjection::SPRITE_H) * ri.h);
+    col = std::min(std::max(col, 0), ri.w - 1);
+    row = std::min(std::max(row, 0), ri.h - 1);
+    return opaqueAt(ri, col, row); // the alpha mask once the pixels live only in the atlas
+}
+
+PickResult IsometricLayer::pick(float px, float py) const {
+    PickResult best;
+    if (!engine || !engine->objMgr) return best;
+    const IsoProjection proj = IsoProjection::fromEngine(engine);
+    const SpatialGrid &grid = engine->objMgr->grid;
+
+    // Painter order: sprites drawn later are over earlier ones (same keys as render)
+    uint64_t bestKey = 0;
+    float bestZ = 0.0f;
+    auto drawnAbove = [&](uint64_t key) { return !best || !(key < bestKey); };
+    auto take = [&](Object* obj, uint64_t key, float z) {
+        best.obj = obj;
+        best.isTile = false;
+        bestKey = key;
+        bestZ = z;
+    };
 
-        SubTexture uv = atlasMap.count(obj->texture) ? atlasMap[obj->texture] : SubTexture{0,0,1,1};
-        float depth = -0.000001f * float(index++);
-        pipeline->appendObjectToVerts(worldVerts, obj, uv, depth);
+    // Objects: inverse-project the pixel into a small world box per unit z-slab and
+    // only test the grid's candidates there. Slabs go top-down, so the first slab with
+    // a hit bounds everything below it.
+    if (grid.hasZRange()) {
+        std::vector<Object*> candidates;
+        float zLo = std::floor(grid.minZ()), zHi = grid.maxZ();
+        float slab = (zHi - zLo) > 256.0f ? (zHi - zLo) + 1.0f : 1.0f; // very tall worlds: one query
+        for (float z0 = std::floor((zHi - zLo) / slab) * slab + zLo; z0 >= zLo; z0 -= slab) {
+            if (best && z0 + slab <= bestZ) break;
+            float x0, y0, x1, y1;
+            proj.coveringBounds(px, py, z0, z0 + slab, x0, y0, x1, y1);
+            candidates.clear();
+            grid.queryRect(x0, y0, x1, y1, candidates);
+            for (Object* obj : candidates) {
+                if (obj->z < z0 || obj->z >= z0 + slab) continue; // tested in its own slab
+                if (obj->invis || obj->obj_class == "tilemap") continue;
+                uint64_t key = objectKey(obj);
+                if (!drawnAbove(key)) continue;
+                if (!spriteCovers(proj, obj->x, obj->y, obj->z, obj->texture, px, py)) continue;
+                take(obj, key, obj->z);
+            }
+        }
     }
 
-    // Upload to global VBO (shared for layers)
-    pipeline->globalVAO.bind();
-    pipeline->globalVBO->bind();
-    pipeline->globalVBO->update(worldVerts.data(), worldVerts.size());
+    // Tilemaps: inverse-project straight into tile coordinates at the map's height
+    for (int id : tilemapIds) {
+        Object* obj = engine->objMgr->findById(id);
+        if (!obj || obj->invis || obj->obj_class != "tilemap") continue;
+        const auto *map = static_cast<const TileMap_OBJ*>(obj);
+        if (best && PaintKey::zOf(PaintKey::make(0.0f, 0.0f, map->z, PaintKey::TILE)) < PaintKey::zOf(bestKey)) continue;
 
-    // Draw
-    pipeline->defaultShader.use();
-    pipeline->defaultShader.setInt("texture1", 0); // ensure sampler uses texture unit 0
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, atlasTex);
-    glDrawArrays(GL_TRIANGLES, 0, (GLsizei)(worldVerts.size() / 8));
+        float x0, y0, x1, y1;
+        proj.coveringBounds(px, py, map->z, map->z, x0, y0, x1, y1);
+        int tx0 = std::max(0, int(std::floor(x0 - map->x))), tx1 = std::min(map->getWidth() - 1, int(std::floor(x1 - map->x)));
+        int ty0 = std::max(0, int(std::floor(y0 - map->y))), ty1 = std::min(map->getHeight() - 1, int(std::floor(y1 - map->y)));
+        for (int ty = ty0; ty <= ty1; ++ty) {
+            for (int tx = tx0; tx <= tx1; ++tx) {
+                TileMap_OBJ::TileId tid = map->getTile(tx, ty);
+                if (!tid) continue;
+                // same position arithmetic as rebuildChunk() so the hit matches the drawn tile
+                float wx = map->x + tx;
+                float wy = map->y + ty;
+                uint64_t key = PaintKey::make(wx, wy, map->z, PaintKey::TILE);
+                if (!drawnAbove(key)) continue;
+                if (!spriteCovers(proj, wx, wy, map->z, map->textureFor(tid), px, py)) continue;
+                take(obj, key, map->z);
+                best.isTile = true;
+                best.tileX = tx;
+                best.tileY = ty;
+            }
+        }
+    }
+    return best;
 }
@@ -2,18 +2,156 @@
 #define ISOMETRIC_LAYER_H
 
 #include "render_layer.h"
+#include "iso_projection.h"
+#include "glAbstract.h"
+#include "sprite_sort.h"
+#include <cmath>
+#include <map>
 #include <vector>
 #include <memory>
+#include <unordered_map>
+#include <unordered_set>
 
 class Object;
+class TileMap_OBJ;
 
+// World sprites in painter order, split by how often they change:
+//  - static sprites (tilemap tiles, objects with the `static` property, and objects that
+//    have not moved or changed texture/visibility for SETTLE_FRAMES frames) live in
+//    CHUNK x CHUNK cell chunks, one per z level, each with a retained GPU buffer that is
+//    only rebuilt when one of its members changes. Chunks are culled as a whole and
+//    drawn with one call each;
+//  - dynamic sprites are kept in a persistent painter-ordered list that is patched from
+//    the change sets (removed, then merged back in as a small sorted delta); each frame
+//    only culls that list and streams what is visible.
+// Painter order is the packed PaintKey (z, chunk row, chunk column, y, x, layer), so
+// every chunk is a contiguous range of it; full sorts are radix sorts on those keys.
+// Dynamic sprites are drawn between the chunks (or inside the chunk range) they sort
+// into, which matches one global sort of everything by that key (see PaintKey for where
+// it departs from plain (z, y, x) order at chunk column seams).
+// Classification follows objManager's change sets, so a frame only touches what changed.
 class IsometricLayer : public RenderLayer {
 public:
     IsometricLayer(Engine* eng, std::vector<std::unique_ptr<Object>>* registry, int atlasSize = 2048);
     virtual void prepare(renderPipeline* pipeline) override;
     virtual void render(renderPipeline* pipeline) override;
+
+    // Topmost sprite covering virtual-resolution pixel (px, py), tested against the
+    // sprite image's alpha so transparent corners fall through to whatever is behind
+    PickResult pick(float px, float py) const;
+
+    // frames without a change before an object moves to the static chunks
+    static const uint64_t SETTLE_FRAMES = 120;
+    // chunk edge in world cells
+    static const int CHUNK = PaintKey::CHUNK;
+
+    // chunks the last render looked up (inside the screen's inverse-projected bounds)
+    size_t chunksConsidered() const { return chunksTested; }
+
+    size_t chunkCount() const { return chunks.size(); }
+    size_t dynamicCount() const { return dynamicIds.size(); }
+    // full re-sorts of the dynamic list so far (the rest were incremental)
+    size_t fullSortCount() const { return fullSorts; }
+
 private:
+    struct Sprite { uint64_t key; float x, y, z; const std::string* texture; };
+    static uint64_t objectKey(const Object* obj);
+
+    using ChunkId = uint64_t; // PaintKey bits above CHUNK_SHIFT: (z, row, column)
+    static ChunkId chunkOfKey(uint64_t key) { return key >> PaintKey::CHUNK_SHIFT; }
+    static int chunkOf(float v) { return int(std::floor(v / float(CHUNK))); }
+
+    // Sort by T::key: radix sort of (key, index) pairs, then one gather pass
+    template <typename T>
+    void sortByKey(std::vector<T>& v, std::vector<T>& scratch);
+    // true if any sprite's image is still decoding (drawn with the placeholder)
+    bool writeInstances(const std::vector<Sprite>& sprites, SpriteInstance* out);
+
+    struct Chunk {
+        std::vector<int> objects;   // static objects anchored here
+        std::vector<int> tilemaps;  // tilemaps with cells here (at this z)
+        std::vector<uint64_t> keys;            // PaintKeys of its instances (painter order)
+        // instances; shared with the GL commands that upload and draw it, so it is only
+        // deleted once the last frame using it has been submitted
+        std::shared_ptr<retainedBuffer> vbo;
+        bool dirty = true;
+        bool placeholder = false;   // some image was still decoding at the last rebuild
+        std::vector<std::string> textures; // images its instances use (holds their residency)
+    };
+    // per-tilemap placement, to tell which chunks an edit or move touches
+    struct MapState {
+        float x = 0.0f, y = 0.0f, z = 0.0f;
+        int width = -1, height = -1;
+        bool invis = false;
+        uint32_t revision = 0;
+        std::vector<uint32_t> chunkRevisions;
+        std::vector<ChunkId> chunks; // chunks listing this map
+    };
+
+    // change tracking -> static / dynamic sets
+    void resync();                  // classify everything in the registry
+    void track(Object* obj);        // new object
+    void touch(Object* obj);        // moved / retextured / shown / hidden
+    void forget(int id);            // destroyed
+    void addStatic(Object* obj);
+    void removeStatic(int id);
+    void syncTilemap(TileMap_OBJ* map);
+    void detachTilemap(int id);
+    void dropIfEmpty(std::map<ChunkId, Chunk>::iterator it);
+    void releaseChunkTextures(Chunk& chunk);
+    void retireChunk(Chunk& chunk); // before erasing: textures released, buffer freed on the GL side
+    void reorder(int id) { reorderIds.insert(id); }
+    void updateOrder();             // apply reorderIds to dynamicOrder
+    void rebuildChunk(ChunkId id, Chunk& chunk);
+    bool chunkVisible(const IsoProjection& proj, ChunkId id) const;
+    // fill `visible`: per z level, only the chunk rows/columns inside the screen's
+    // inverse-projected bounds are looked up
+    void collectVisibleChunks(const IsoProjection& proj);
+
     std::vector<std::unique_ptr<Object>>* registry = nullptr;
+    std::vector<int> tilemapIds; // live tilemaps (drawn from the chunks, used for picking)
+
+    std::map<ChunkId, Chunk> chunks;                 // in painter order
+    std::unordered_map<int, ChunkId> staticChunk;    // static object -> its chunk
+    std::unordered_map<int, uint64_t> dynamicIds;    // dynamic objects -> frame of their last change
+    // id is kept apart from obj: a destroyed object's entry is dropped after the registry freed it
+    struct DynamicEntry { uint64_t key; float x, y, z; Object* obj; int id; };
+    std::vector<DynamicEntry> dynamicOrder;          // every dynamic object, painter order
+    std::vector<float> orderX, orderY, orderZ;       // its positions as columns, for SpriteBatch::cull
+    bool orderColumnsStale = true;
+    std::unordered_set<int> reorderIds;              // entries to drop and re-insert if still dynamic
+    size_t fullSorts = 0;
+    std::unordered_map<int, MapState> mapStates;
+    uint64_t frame = 0;
+    uint64_t lastCommit = 0;
+    bool synced = false;
+    unsigned int chunkAtlasVersion = 0;
+    unsigned int chunkPlaceholderVersion = 0;
+
+    // scratch, reused between frames
+    std::vector<Sprite> sprites;                     // dynamic sprites
+    std::vector<uint32_t> onScreen;                  // dynamicOrder indices that passed culling
+    std::vector<Sprite> chunkSprites;                // chunk rebuilds
+    std::vector<std::string> chunkTextures;
+    std::vector<DynamicEntry> orderDelta, orderMerged;
+    std::vector<Sprite> spriteScratch;
+    std::vector<RadixSorter::Item> sortItems;
+    RadixSorter sorter;
+    std::vector<Chunk*> visible;
+    size_t chunksTested = 0;
+
+    bool spriteCovers(const IsoProjection& proj, float wx, float wy, float wz,
+                      const std::string& texture, float px, float py) const;
 };
 
+template <typename T>
+void IsometricLayer::sortByKey(std::vector<T>& v, std::vector<T>& scratch) {
+    sortItems.resize(v.size());
+    for (size_t i = 0; i < v.size(); ++i) sortItems[i] = RadixSorter::Item{v[i].key, uint32_t(i)};
+    sorter.sort(sortItems);
+    scratch.resize(v.size());
+    for (size_t i = 0; i < v.size(); ++i) scratch[i] = v[sortItems[i].index];
+    v.swap(scratch);
+}
+
 #endif // ISOMETRIC_LAYER_H
@@ -1,12 +1,19 @@
 #include "engine/render/render_layer.h"
 #include "engine/render/renderm.h"
+#include "engine/render/atlas_packer.h"
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
 #include <iostream>
 #include <cstring>
 #include "incl/stb_image.h"
 #include <GL/gl.h>
 
+// 1px padding between atlas images to avoid sampling bleed
+static const int ATLAS_PAD = 1;
+
 RenderLayer::RenderLayer(Engine* eng, int atlasSize)
-    : engine(eng), atlasSize(atlasSize) {}
+    : engine(eng), atlasSize(atlasSize), atlasPacker(atlasSize, atlasSize, ATLAS_PAD) {}
 
 RenderLayer::~RenderLayer() {
     // free raw images
@@ -16,11 +23,23 @@ RenderLayer::~RenderLayer() {
     rawImages.clear();
 
     if (atlasTex) {
-        glDeleteTextures(1, &atlasTex);
+        glState::deleteTexture(atlasTex);
         atlasTex = 0;
     }
 }
 
+void RenderLayer::gl(std::function<void()> cmd) {
+    if (owner) owner->record(std::move(cmd));
+    else cmd();
+}
+
+void RenderLayer::glNow(const std::function<void()>& fn) {
+    if (owner) owner->invoke(fn);
+    else fn();
+}
+
+const char* const RenderLayer::LOADING_IMAGE = "<loading>";
+
 bool RenderLayer::ensureImageLoaded(const std::string& path) {
     // If already loaded, ok
     if (rawImages.count(path)) return true;
@@ -32,28 +51,242 @@ bool RenderLayer::ensureImageLoaded(const std::string& path) {
         ri.h = 1;
         ri.pixels = (unsigned char*)malloc(4);
         ri.pixels[0] = 255; ri.pixels[1] = 255; ri.pixels[2] = 255; ri.pixels[3] = 255;
-        rawImages[path] = ri;
+        addRawImage(path, ri);
         return true;
     }
+    if (loadingImages.count(path)) return false;
 
-    int w,h,channels;
-    unsigned char* data = stbi_load(path.c_str(), &w, &h, &channels, 4);
-    if (!data) {
-        std::cerr << "RenderLayer: failed to load image: " << path << " -- using placeholder" << std::endl;
-        // Insert placeholder under the requested key so lookups by path succeed
+    // Drawn in its place until it arrives: 1x1 translucent grey
+    if (!rawImages.count(LOADING_IMAGE)) {
         RawImage ri;
         ri.w = 1;
         ri.h = 1;
         ri.pixels = (unsigned char*)malloc(4);
-        ri.pixels[0] = 255; ri.pixels[1] = 0; ri.pixels[2] = 255; ri.pixels[3] = 255; // magenta -> obvious placeholder
-        rawImages[path] = ri;
-        return true; // return true because we can still render with placeholder
-    }
-    RawImage ri;
-    ri.w = w;
-    ri.h = h;
-    ri.pixels = data;
+        ri.pixels[0] = 128; ri.pixels[1] = 128; ri.pixels[2] = 128; ri.pixels[3] = 96;
+        addRawImage(LOADING_IMAGE, ri);
+    }
+
+    // decode off the render thread; collectDecodedImages() picks it up
+    if (!imageLoader) imageLoader = std::make_unique<ImageLoader>();
+    imageLoader->request(path);
+    loadingImages.insert(path);
+    return false;
+}
+
+void RenderLayer::collectDecodedImages() {
+    if (!imageLoader || loadingImages.empty()) return;
+    decoded.clear();
+    if (imageLoader->collect(decoded) == 0) return;
+    for (auto &d : decoded) {
+        loadingImages.erase(d.path);
+        RawImage ri;
+        if (!d.pixels) {
+            std::cerr << "RenderLayer: failed to load image: " << d.path << " -- using placeholder" << std::endl;
+            // Insert placeholder under the requested key so lookups by path succeed
+            ri.w = 1;
+            ri.h = 1;
+            ri.pixels = (unsigned char*)malloc(4);
+            ri.pixels[0] = 255; ri.pixels[1] = 0; ri.pixels[2] = 255; ri.pixels[3] = 255; // magenta -> obvious placeholder
+        } else {
+            ri.w = d.w;
+            ri.h = d.h;
+            ri.pixels = d.pixels;
+        }
+        addRawImage(d.path, ri);
+        shownAsPlaceholder.insert(d.path);
+    }
+    decoded.clear();
+}
+
+bool RenderLayer::lookupSubTexture(const std::string& path, SubTexture& out) {
+    auto it = atlasMap.find(path);
+    if (it != atlasMap.end()) {
+        auto r = residency.find(path);
+        if (r != residency.end()) r->second.lastUsed = layerFrame;
+        out = it->second;
+        return true;
+    }
+    if (!rawImages.count(path)) ensureImageLoaded(path); // evicted: load it again
+    auto ph = atlasMap.find(LOADING_IMAGE);
+    out = ph != atlasMap.end() ? ph->second : SubTexture{0,0,1,1};
+    return false;
+}
+
+void RenderLayer::addRawImage(const std::string& path, const RawImage& ri) {
     rawImages[path] = ri;
+    pendingImages.push_back(path); // a full build picks it up as well
+}
+
+bool RenderLayer::opaqueAt(const RawImage& ri, int x, int y) {
+    size_t i = size_t(y) * ri.w + x;
+    if (ri.pixels) return ri.pixels[i * 4 + 3] != 0;
+    if (ri.alpha.empty()) return true;
+    return (ri.alpha[i >> 3] >> (i & 7)) & 1;
+}
+
+void RenderLayer::releasePixels(RawImage& ri) {
+    if (!ri.pixels) return;
+    size_t n = size_t(ri.w) * ri.h;
+    ri.alpha.assign((n + 7) / 8, 0);
+    for (size_t i = 0; i < n; ++i) {
+        if (ri.pixels[i * 4 + 3]) ri.alpha[i >> 3] |= uint8_t(1u << (i & 7));
+    }
+    stbi_image_free(ri.pixels);
+    ri.pixels = nullptr;
+}
+
+void RenderLayer::releaseUploadedPixels() {
+    for (const std::string &path : uploadedImages) {
+        auto it = rawImages.find(path);
+        if (it != rawImages.end() && atlasMap.count(path)) releasePixels(it->second);
+    }
+    uploadedImages.clear();
+}
+
+void RenderLayer::restorePixelsFromAtlas() {
+    if (!atlasBuilt || atlasPages <= 0) return;
+    bool needed = false;
+    for (auto &p : rawImages) {
+        if (!p.second.pixels && atlasMap.count(p.first)) { needed = true; break; }
+    }
+    if (!needed) return;
+
+    // one readback of every page; each image's trimmed box is copied out of its rect
+    const size_t pageBytes = size_t(atlasSize) * size_t(atlasSize) * 4;
+    std::vector<unsigned char> pages(pageBytes * size_t(atlasPages));
+    // waits for the render thread: every image without pixels was uploaded by a submitted frame
+    glNow([&] {
+        glState::bindTexture(GL_TEXTURE_2D_ARRAY, atlasTex);
+        glGetTexImage(GL_TEXTURE_2D_ARRAY, 0, GL_RGBA, GL_UNSIGNED_BYTE, pages.data());
+    });
+    for (auto &p : rawImages) {
+        RawImage &ri = p.second;
+        auto it = atlasMap.find(p.first);
+        if (ri.pixels || it == atlasMap.end()) continue;
+        const SubTexture &st = it->second;
+        ri.pixels = (unsigned char*)calloc(size_t(ri.w) * size_t(ri.h), 4); // trimmed borders stay transparent
+        if (!ri.pixels) continue;
+        int tx = int(std::lround(st.x0 * ri.w)), ty = int(std::lround(st.y0 * ri.h));
+        int tw = int(std::lround(st.x1 * ri.w)) - tx, th = int(std::lround(st.y1 * ri.h)) - ty;
+        int ax = int(std::lround(st.u0 * atlasSize)), ay = int(std::lround(st.v0 * atlasSize));
+        const unsigned char* page = pages.data() + size_t(st.page) * pageBytes;
+        for (int row = 0; row < th; ++row) {
+            memcpy(ri.pixels + (size_t(ty + row) * ri.w + tx) * 4, page + (size_t(ay + row) * atlasSize + ax) * 4, size_t(tw) * 4);
+        }
+    }
+}
+
+void RenderLayer::acquireTexture(const std::string& path) {
+    Residency &r = residency[path];
+    ++r.refs;
+    r.lastUsed = layerFrame;
+}
+
+void RenderLayer::releaseTexture(const std::string& path) {
+    auto it = residency.find(path);
+    if (it == residency.end()) return;
+    if (it->second.refs) --it->second.refs;
+    it->second.lastUsed = layerFrame;
+    if (!it->second.refs && !atlasMap.count(path)) residency.erase(it);
+}
+
+void RenderLayer::evictImage(const std::string& path) {
+    auto it = atlasMap.find(path);
+    if (it != atlasMap.end()) {
+        const SubTexture &st = it->second;
+        AtlasPacker::Slot slot;
+        slot.page = st.page;
+        slot.x = int(std::lround(st.u0 * atlasSize));
+        slot.y = int(std::lround(st.v0 * atlasSize));
+        auto rit = residency.find(path);
+        auto cit = rit != residency.end() ? atlasContent.find(rit->second.hash) : atlasContent.end();
+        if (cit != atlasContent.end()) {
+            auto &rects = cit->second;
+            for (size_t i = 0; i < rects.size(); ++i) {
+                AtlasRect &r = rects[i];
+                if (r.slot.page != slot.page || r.slot.x != slot.x || r.slot.y != slot.y) continue;
+                if (--r.paths == 0) {
+                    // last path using the rect: its space goes back to the packer
+                    atlasPacker.release(r.slot, r.w, r.h);
+                    residentBytes -= size_t(r.w) * size_t(r.h) * 4;
+                    rects.erase(rects.begin() + i);
+                }
+                break;
+            }
+            if (rects.empty()) atlasContent.erase(cit);
+        }
+        atlasMap.erase(it);
+    }
+    residency.erase(path);
+    auto raw = rawImages.find(path);
+    if (raw != rawImages.end()) {
+        if (raw->second.pixels) stbi_image_free(raw->second.pixels);
+        rawImages.erase(raw);
+    }
+}
+
+void RenderLayer::evictUnused() {
+    if (textureBudget == 0 || residentBytes <= textureBudget || layerFrame < nextEvictionScan) return;
+    nextEvictionScan = layerFrame + EVICT_SCAN_FRAMES;
+
+    // unreferenced and idle, oldest first; the synthesized placeholders can't be reloaded
+    std::vector<std::pair<uint64_t, std::string>> idle;
+    for (auto &r : residency) {
+        if (r.second.refs || layerFrame - r.second.lastUsed < EVICT_GRACE_FRAMES) continue;
+        if (r.first.empty() || r.first == LOADING_IMAGE || !atlasMap.count(r.first)) continue;
+        idle.push_back({r.second.lastUsed, r.first});
+    }
+    std::sort(idle.begin(), idle.end());
+    size_t evicted = 0, before = residentBytes;
+    for (auto &c : idle) {
+        if (residentBytes <= textureBudget) break;
+        evictImage(c.second);
+        ++evicted;
+    }
+    atlasOccupancy = atlasPacker.occupancy();
+    if (evicted) {
+        std::cout << "RenderLayer: evicted " << evicted << " unused image(s) (" << (before - residentBytes) / 1024
+                  << " KB), " << residentBytes / 1024 << " KB resident of a " << textureBudget / 1024 << " KB budget\n";
+    }
+}
+
+RenderLayer::TrimmedImage RenderLayer::trimImage(const std::string& path, const RawImage& ri) {
+    TrimmedImage t{&path, &ri, 0, 0, 0, 0, 0};
+    // tight box around the pixels with any alpha
+    int x0 = ri.w, y0 = ri.h, x1 = -1, y1 = -1;
+    for (int y = 0; y < ri.h; ++y) {
+        const unsigned char* row = ri.pixels + size_t(y) * ri.w * 4;
+        for (int x = 0; x < ri.w; ++x) {
+            if (!row[x * 4 + 3]) continue;
+            x0 = std::min(x0, x); x1 = std::max(x1, x);
+            y0 = std::min(y0, y); y1 = std::max(y1, y);
+        }
+    }
+    if (x1 < 0) { x0 = y0 = 0; x1 = y1 = 0; } // fully transparent: keep one (transparent) pixel
+    t.x = x0; t.y = y0;
+    t.w = x1 - x0 + 1; t.h = y1 - y0 + 1;
+
+    // FNV-1a over the trimmed size and pixels; identical content loaded under several
+    // paths shares one atlas rect
+    uint64_t h = 1469598103934665603ull;
+    auto mix = [&h](const unsigned char* p, size_t n) {
+        for (size_t i = 0; i < n; ++i) { h ^= p[i]; h *= 1099511628211ull; }
+    };
+    int dims[4] = {ri.w, ri.h, t.w, t.h};
+    mix(reinterpret_cast<const unsigned char*>(dims), sizeof(dims));
+    for (int y = 0; y < t.h; ++y) mix(ri.pixels + (size_t(t.y + y) * ri.w + t.x) * 4, size_t(t.w) * 4);
+    t.hash = h;
+    return t;
+}
+
+bool RenderLayer::sameContent(const TrimmedImage& a, const TrimmedImage& b) {
+    if (a.hash != b.hash || a.w != b.w || a.h != b.h || a.img->w != b.img->w || a.img->h != b.img->h) return false;
+    if (a.x != b.x || a.y != b.y) return false; // same trimmed pixels at another offset place differently
+    for (int y = 0; y < a.h; ++y) {
+        const unsigned char* pa = a.img->pixels + (size_t(a.y + y) * a.img->w + a.x) * 4;
+        const unsigned char* pb = b.img->pixels + (size_t(b.y + y) * b.img->w + b.x) * 4;
+        if (memcmp(pa, pb, size_t(a.w) * 4) != 0) return false;
+    }
     return true;
 }
 
@@ -63,116 +296,318 @@ void RenderLayer::buildAtlasFromRawImages() {
     const int ATLAS_W = atlasSize;
     const int ATLAS_H = atlasSize;
 
-    // Gather list of images to pack (rawImages must be filled)
-    std::vector<std::pair<std::string, RawImage>> imgs;
-    imgs.reserve(rawImages.size());
-    for (auto &p : rawImages) imgs.push_back(p);
+    // Trim every image to its visible pixels and fold identical content together
+    std::vector<TrimmedImage> unique;     // one per distinct content
+    std::vector<std::pair<const std::string*, size_t>> aliases; // path -> unique index
+    std::unordered_map<uint64_t, std::vector<size_t>> byHash;
+    unique.reserve(rawImages.size());
+    aliases.reserve(rawImages.size());
+    for (auto &p : rawImages) {
+        const RawImage &ri = p.second;
+        if (ri.w <= 0 || ri.h <= 0 || !ri.pixels) {
+            std::cerr << "RenderLayer: invalid image size: " << p.first << "\n";
+            continue;
+        }
+        TrimmedImage t = trimImage(p.first, ri);
+        size_t index = unique.size();
+        for (size_t candidate : byHash[t.hash]) {
+            if (sameContent(unique[candidate], t)) { index = candidate; break; }
+        }
+        if (index == unique.size()) {
+            byHash[t.hash].push_back(index);
+            unique.push_back(t);
+        }
+        aliases.push_back({&p.first, index});
+    }
+
+    // Largest first (longest side, then area; path for a stable layout), which is
+    // what keeps MaxRects dense
+    std::vector<size_t> order(unique.size());
+    for (size_t i = 0; i < order.size(); ++i) order[i] = i;
+    std::sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+        const TrimmedImage &A = unique[a], &B = unique[b];
+        int sa = std::max(A.w, A.h), sb = std::max(B.w, B.h);
+        if (sa != sb) return sa > sb;
+        if (A.w * A.h != B.w * B.h) return A.w * A.h > B.w * B.h;
+        return *A.path < *B.path;
+    });
+
+    AtlasPacker &packer = atlasPacker;
+    packer.clear();
+    atlasContent.clear();
+    residentBytes = 0;
+    pendingImages.clear();
+    shownAsPlaceholder.clear(); // every chunk is rebuilt after a build anyway
+    std::vector<AtlasPacker::Slot> slots(unique.size());
+    std::vector<bool> packed(unique.size(), false);
+    for (size_t i : order) {
+        const TrimmedImage &t = unique[i];
+        if (!packer.insert(t.w, t.h, slots[i])) {
+            std::cerr << "RenderLayer: image larger than an atlas page (" << ATLAS_W << "x" << ATLAS_H << "): " << *t.path << "\n";
+            continue; // skip this image (transparent will show)
+        }
+        packed[i] = true;
+    }
+    int pages = std::max(packer.pageCount(), 1);
 
-    // Simple shelf packer: place images left-to-right, when no space -> new row
-    int curX = 0;
-    int curY = 0;
-    int rowH = 0;
+    GLint maxLayers = owner ? owner->maxArrayLayers() : 0;
+    if (!owner) glGetIntegerv(GL_MAX_ARRAY_TEXTURE_LAYERS, &maxLayers);
+    if (maxLayers > 0 && pages > maxLayers) {
+        std::cerr << "RenderLayer: atlas needs " << pages << " pages, GL allows " << maxLayers << "; dropping the rest\n";
+        pages = maxLayers;
+    }
 
-    // create atlas pixel buffer RGBA
-    size_t atlasBytes = size_t(ATLAS_W) * size_t(ATLAS_H) * 4;
-    unsigned char* atlasPixels = (unsigned char*)malloc(atlasBytes);
+    // create atlas pixel buffer RGBA, pages stacked
+    size_t pageBytes = size_t(ATLAS_W) * size_t(ATLAS_H) * 4;
+    unsigned char* atlasPixels = (unsigned char*)calloc(size_t(pages), pageBytes); // transparent
     if (!atlasPixels) {
         std::cerr << "RenderLayer: failed to allocate atlas buffer\n";
         return;
     }
-    // initialize transparent
-    memset(atlasPixels, 0, atlasBytes);
 
-    for (auto &p : imgs) {
-        const std::string &path = p.first;
-        const RawImage &ri = p.second;
+    for (size_t i = 0; i < unique.size(); ++i) {
+        if (!packed[i] || slots[i].page >= pages) continue;
+        const TrimmedImage &t = unique[i];
+        const AtlasPacker::Slot &slot = slots[i];
+        // copy the trimmed rows into atlasPixels
+        unsigned char* pagePixels = atlasPixels + size_t(slot.page) * pageBytes;
+        for (int row = 0; row < t.h; ++row) {
+            unsigned char* dst = pagePixels + (size_t(slot.y + row) * ATLAS_W + slot.x) * 4;
+            const unsigned char* src = t.img->pixels + (size_t(t.y + row) * t.img->w + t.x) * 4;
+            memcpy(dst, src, size_t(t.w) * 4);
+        }
+    }
+
+    std::vector<uint32_t> users(unique.size(), 0);
+    for (auto &a : aliases) {
+        size_t i = a.second;
+        if (!packed[i] || slots[i].page >= pages) continue;
+        atlasMap[*a.first] = placedSubTexture(unique[i], slots[i]);
+        Residency &r = residency[*a.first];
+        r.hash = unique[i].hash;
+        if (!r.lastUsed) r.lastUsed = layerFrame;
+        ++users[i];
+    }
+    for (size_t i = 0; i < unique.size(); ++i) {
+        if (!users[i]) continue;
+        const TrimmedImage &t = unique[i];
+        atlasContent[t.hash].push_back(AtlasRect{t.hash, t.img->w, t.img->h, t.x, t.y, t.w, t.h, slots[i], users[i]});
+        residentBytes += size_t(t.w) * size_t(t.h) * 4;
+    }
+    // references outlive a rebuild; entries for images no longer in the atlas don't
+    for (auto it = residency.begin(); it != residency.end();) {
+        if (!it->second.refs && !atlasMap.count(it->first)) it = residency.erase(it);
+        else ++it;
+    }
+
+    // upload to GL: one texture array, so every page is reachable from a single draw.
+    // The command owns atlasPixels and frees them once it has run.
+    std::shared_ptr<unsigned char> pixels(atlasPixels, free);
+    gl([this, pixels, ATLAS_W, ATLAS_H, pages] {
+        glGenTextures(1, &atlasTex);
+        glState::bindTexture(GL_TEXTURE_2D_ARRAY, atlasTex);
+        // Use nearest filtering (no mipmaps) for crisp atlas sampling (important for glyphs)
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glState::bindBuffer(GL_PIXEL_UNPACK_BUFFER, 0); // pixels are client memory
+        glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_RGBA8, ATLAS_W, ATLAS_H, pages, 0, GL_RGBA, GL_UNSIGNED_BYTE, pixels.get());
+    });
 
-        if (ri.w <= 0 || ri.h <= 0) {
+    // the images' CPU copies go next frame (alpha masks stay)
+    for (auto &p : rawImages) {
+        if (atlasMap.count(p.first)) uploadedImages.push_back(p.first);
+    }
+
+    atlasPages = pages;
+    atlasOccupancy = packer.occupancy();
+    atlasBuilt = true;
+    ++atlasVersion;
+    std::cout << "RenderLayer: atlas built with " << atlasMap.size() << " entries (" << unique.size()
+              << " distinct) on " << pages << " page(s), " << int(atlasOccupancy * 100.0 + 0.5) << "% occupied\n";
+}
+
+SubTexture RenderLayer::placedSubTexture(const TrimmedImage& t, const AtlasPacker::Slot& slot) const {
+    SubTexture st;
+    // store UV coords (note: v coordinate flip depending on your texture coordinates convention)
+    st.u0 = float(slot.x) / float(atlasSize);
+    st.v0 = float(slot.y) / float(atlasSize);
+    st.u1 = float(slot.x + t.w) / float(atlasSize);
+    st.v1 = float(slot.y + t.h) / float(atlasSize);
+    st.page = slot.page;
+    // where the trimmed box sits in the whole image
+    st.x0 = float(t.x) / float(t.img->w);
+    st.y0 = float(t.y) / float(t.img->h);
+    st.x1 = float(t.x + t.w) / float(t.img->w);
+    st.y1 = float(t.y + t.h) / float(t.img->h);
+    return st;
+}
+
+bool RenderLayer::insertPendingImages(renderPipeline* pipeline) {
+    size_t inserted = 0, shared = 0, uploaded = 0, next = 0;
+    bool arrived = false;
+    for (; next < pendingImages.size() && uploaded < uploadBudget; ++next) {
+        const std::string &path = pendingImages[next];
+        auto it = rawImages.find(path);
+        if (it == rawImages.end() || atlasMap.count(path)) continue;
+        const RawImage &ri = it->second;
+        if (ri.w <= 0 || ri.h <= 0 || !ri.pixels) {
             std::cerr << "RenderLayer: invalid image size: " << path << "\n";
             continue;
         }
+        TrimmedImage t = trimImage(it->first, ri);
 
-        // Add 1px padding between images to avoid sampling bleed
-        const int PAD = 1;
-        // If image doesn't fit in current row, move to next row
-        if (curX + ri.w + PAD > ATLAS_W) {
-            curX = 0;
-            curY += rowH + PAD;
-            rowH = 0;
+        // content already in the atlas: share its rect
+        bool found = false;
+        auto &sameHash = atlasContent[t.hash];
+        for (AtlasRect &other : sameHash) {
+            if (!other.holds(t)) continue;
+            atlasMap[path] = placedSubTexture(t, other.slot);
+            ++other.paths;
+            found = true;
+            break;
         }
-
-        // If it doesn't fit vertically -> fail (you can expand atlas or handle)
-        if (curY + ri.h + PAD > ATLAS_H) {
-            std::cerr << "RenderLayer: atlas overflow, image too large or atlas too small: " << path << "\n";
-            continue; // skip this image (transparent will show)
+        if (found) {
+            ++shared;
+            residency[path].hash = t.hash;
+            residency[path].lastUsed = layerFrame;
+            releasePixels(it->second);
+            arrived |= shownAsPlaceholder.erase(path) > 0;
+            continue;
         }
 
-        // copy rows into atlasPixels
-        for (int row = 0; row < ri.h; ++row) {
-            unsigned char* dst = atlasPixels + ( (curY + row) * ATLAS_W + curX ) * 4;
-            unsigned char* src = ri.pixels + row * ri.w * 4;
-            memcpy(dst, src, ri.w * 4);
+        if (t.w > atlasSize || t.h > atlasSize) {
+            std::cerr << "RenderLayer: image larger than an atlas page (" << atlasSize << "x" << atlasSize << "): " << path << "\n";
+            continue;
+        }
+        AtlasPacker::Slot slot;
+        if (!atlasPacker.insert(t.w, t.h, slot, false) || slot.page >= atlasPages) {
+            return false; // no room left in the existing pages
         }
 
-        // store UV coords (note: v coordinate flip depending on your texture coordinates convention)
-        float u0 = float(curX) / float(ATLAS_W);
-        float v0 = float(curY) / float(ATLAS_H);
-        float u1 = float(curX + ri.w) / float(ATLAS_W);
-        float v1 = float(curY + ri.h) / float(ATLAS_H);
-
-        // store in atlasMap
-        atlasMap[path] = SubTexture{u0, v0, u1, v1};
+        // upload just the trimmed rect into its page; the command gets its own tight copy
+        const size_t bytes = size_t(t.w) * size_t(t.h) * 4;
+        auto rect = std::make_shared<std::vector<unsigned char>>(bytes);
+        for (int row = 0; row < t.h; ++row) {
+            memcpy(rect->data() + size_t(row) * t.w * 4, ri.pixels + (size_t(t.y + row) * ri.w + t.x) * 4, size_t(t.w) * 4);
+        }
+        streamBuffer* pbo = pipeline ? pipeline->pixelUnpack : nullptr;
+        gl([this, pbo, rect, slot, w = t.w, h = t.h] {
+            glState::bindTexture(GL_TEXTURE_2D_ARRAY, atlasTex);
+            size_t offset = 0;
+            void* dst = pbo ? pbo->map(rect->size(), 4, offset) : nullptr;
+            if (dst) {
+                // staged through the pixel ring: the copy into the texture happens on the GPU
+                memcpy(dst, rect->data(), rect->size());
+                pbo->unmap();
+                glState::bindBuffer(GL_PIXEL_UNPACK_BUFFER, pbo->id());
+                glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, slot.x, slot.y, slot.page, w, h, 1,
+                                GL_RGBA, GL_UNSIGNED_BYTE, (void*)offset);
+                glState::bindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+            } else {
+                glState::bindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+                glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, slot.x, slot.y, slot.page, w, h, 1,
+                                GL_RGBA, GL_UNSIGNED_BYTE, rect->data());
+            }
+        });
 
-        // advance (add padding)
-        curX += ri.w + PAD;
-        if (ri.h > rowH) rowH = ri.h + PAD;
+        atlasMap[path] = placedSubTexture(t, slot);
+        sameHash.push_back(AtlasRect{t.hash, ri.w, ri.h, t.x, t.y, t.w, t.h, slot, 1});
+        residentBytes += bytes;
+        residency[path].hash = t.hash;
+        residency[path].lastUsed = layerFrame;
+        uploadedImages.push_back(path);
+        arrived |= shownAsPlaceholder.erase(path) > 0;
+        uploaded += bytes;
+        ++inserted;
     }
-
-    // upload to GL
-    glGenTextures(1, &atlasTex);
-    glBindTexture(GL_TEXTURE_2D, atlasTex);
-    // Use nearest filtering (no mipmaps) for crisp atlas sampling (important for glyphs)
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-
-    // upload
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, ATLAS_W, ATLAS_H, 0, GL_RGBA, GL_UNSIGNED_BYTE, atlasPixels);
-
-    // free temporary atlasPixels (rawImages kept until destructor)
-    free(atlasPixels);
-
-    atlasBuilt = true;
-    std::cout << "RenderLayer: atlas built with " << atlasMap.size() << " entries\n";
+    // over budget: the rest go in on the next frames
+    pendingImages.erase(pendingImages.begin(), pendingImages.begin() + next);
+    if (arrived) ++placeholderVersion;
+    atlasOccupancy = atlasPacker.occupancy();
+    if (inserted || shared) {
+        std::cout << "RenderLayer: inserted " << inserted << " image(s) into the atlas (" << shared << " shared), "
+                  << int(atlasOccupancy * 100.0 + 0.5) << "% occupied\n";
+    }
+    return true;
 }
 
 void RenderLayer::rebuildAtlas() {
-    if (atlasTex) {
-        glDeleteTextures(1, &atlasTex);
+    // CPU copies were freed after upload: read them back before the texture goes
+    restorePixelsFromAtlas();
+    gl([this] {
+        glState::deleteTexture(atlasTex);
         atlasTex = 0;
-    }
+    });
     atlasMap.clear();
     atlasBuilt = false;
     buildAtlasFromRawImages();
 }
 
 void RenderLayer::prepare(renderPipeline* pipeline) {
-    // default prepare: build atlas from current rawImages (if not already built)
+    // default prepare: build atlas from current rawImages (if not already built), then
+    // slot later images (and finished decodes) into free space; a full repack only when
+    // they no longer fit
+    ++layerFrame;
+    releaseUploadedPixels(); // last frame's uploads are submitted by now
+    updateAtlas(pipeline);
+}
+
+void RenderLayer::updateAtlas(renderPipeline* pipeline) {
+    collectDecodedImages();
+    evictUnused(); // frees atlas space before new images need it
     if (!atlasBuilt) buildAtlasFromRawImages();
+    else if (!pendingImages.empty() && !insertPendingImages(pipeline)) {
+        std::cout << "RenderLayer: atlas full or fragmented, repacking\n";
+        rebuildAtlas();
+    }
+}
+
+void RenderLayer::drawVerts(renderPipeline* pipeline, const std::vector<float>& verts) {
+    if (verts.empty()) return;
+    // Stream into the pipeline's vertex ring (no reallocation, no sync with the GPU)
+    const size_t VERTEX_BYTES = 8 * sizeof(float);
+    const size_t bytes = verts.size() * sizeof(float);
+    StreamRef ref;
+    void* dst = pipeline->streamAlloc(bytes, VERTEX_BYTES, ref);
+    if (!dst) return;
+    memcpy(dst, verts.data(), bytes);
+    pipeline->streamDone();
+
+    // Draw using pipeline shader and this layer's atlas
+    gl([this, pipeline, ref, count = verts.size() / 8, VERTEX_BYTES] {
+        pipeline->globalVAO.bind(); // layout set up by the pipeline
+        pipeline->useShader(FLOAT_VERTS);
+        glState::activeTexture(GL_TEXTURE0);
+        glState::bindTexture(GL_TEXTURE_2D_ARRAY, atlasTex);
+        glDrawArrays(GL_TRIANGLES, (GLint)(pipeline->streamOffset(ref) / VERTEX_BYTES), (GLsizei)count);
+    });
 }
 
-void RenderLayer::drawVerts(renderPipeline* pipeline, const std::vector<float>& verts, unsigned int tex) {
-    // Upload to global VBO (shared across layers)
-    pipeline->globalVAO.bind();
-    pipeline->globalVBO->bind();
-    pipeline->globalVBO->update(verts.data(), verts.size());
+void RenderLayer::drawQuads(renderPipeline* pipeline, const std::vector<QuadVertex>& verts) {
+    const size_t quads = verts.size() / 4;
+    if (quads == 0) return;
+    const size_t bytes = quads * 4 * sizeof(QuadVertex);
+    StreamRef ref;
+    void* dst = pipeline->streamAlloc(bytes, sizeof(QuadVertex), ref);
+    if (!dst) return;
+    memcpy(dst, verts.data(), bytes);
+    pipeline->streamDone();
+    gl([this, pipeline, ref, quads] { drawStreamedQuads(pipeline, pipeline->streamOffset(ref), quads); });
+}
 
-    // Draw using pipeline shader and specified texture
-    pipeline->defaultShader.use();
-    pipeline->defaultShader.setInt("texture1", 0);
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, tex);
-    glDrawArrays(GL_TRIANGLES, 0, (GLsizei)(verts.size() / 8));
+void RenderLayer::drawStreamedQuads(renderPipeline* pipeline, size_t offset, size_t quads) {
+    // Attributes (set up once in quadVAO) always start at 0; the region is selected with
+    // the base vertex
+    pipeline->quadVAO.bind();
+    pipeline->useShader(QUAD_VERTS);
+    glState::activeTexture(GL_TEXTURE0);
+    glState::bindTexture(GL_TEXTURE_2D_ARRAY, atlasTex);
+    const size_t first = offset / sizeof(QuadVertex);
+    for (size_t q = 0; q < quads; q += renderPipeline::QUAD_BATCH) {
+        size_t n = std::min(quads - q, size_t(renderPipeline::QUAD_BATCH));
+        glDrawElementsBaseVertex(GL_TRIANGLES, (GLsizei)(n * 6), GL_UNSIGNED_SHORT, nullptr, (GLint)(first + q * 4));
+    }
 }
 
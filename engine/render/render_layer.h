@@ -2,17 +2,22 @@
 #define RENDER_LAYER_H
 
 #include <unordered_map>
+#include <unordered_set>
 #include <string>
 #include <memory>
 #include <vector>
+#include <functional>
 
 #include "engine/enginem.h"
 #include "render_types.h"
+#include "atlas_packer.h"
+#include "image_loader.h"
 
 // Forward
 class renderPipeline;
 
 class RenderLayer {
+    friend class renderPipeline;
 public:
     explicit RenderLayer(Engine* eng, int atlasSize = 2048);
     virtual ~RenderLayer();
@@ -22,24 +27,132 @@ public:
         virtual void prepare(renderPipeline* pipeline);
     virtual void rebuildAtlas();
 
+    // Atlas bytes (trimmed RGBA) unused images may hold before the least recently used
+    // are evicted; 0 keeps everything. Evicted images reload when looked up again.
+    void setTextureBudget(size_t bytes) { textureBudget = bytes; }
+    size_t residentTextureBytes() const { return residentBytes; }
+
 protected:
     Engine* engine = nullptr;
+    // GL work goes through the pipeline that owns the layer: gl() records a command (run
+    // at once unless a render thread submits it), glNow() waits for it to run. Without an
+    // owner both run inline.
+    renderPipeline* owner = nullptr;
+    void gl(std::function<void()> cmd);
+    void glNow(const std::function<void()>& fn);
+
+    // GL_TEXTURE_2D_ARRAY, one atlasSize x atlasSize layer per page; only read and written
+    // inside GL commands
     unsigned int atlasTex = 0;
     int atlasSize = 2048;
+    int atlasPages = 0;
+    double atlasOccupancy = 0.0; // packed image area / page area, kept current by inserts
     bool atlasBuilt = false;
+    unsigned int atlasVersion = 0; // bumped by every atlas build (UVs may have moved)
+    // bumped when images that were drawn as the loading placeholder reach the atlas
+    unsigned int placeholderVersion = 0;
     std::unordered_map<std::string, SubTexture> atlasMap; // path -> uv
 
     struct RawImage {
         int w, h;
-        unsigned char* pixels = nullptr; // 4 channels RGBA
+        unsigned char* pixels = nullptr; // 4 channels RGBA; freed once the image is in the atlas
+        std::vector<uint8_t> alpha;      // 1 bit per pixel, row-major; kept for picking
     };
+    // pixel (x, y) has alpha, from the pixels or the retained mask (no data: opaque)
+    static bool opaqueAt(const RawImage& ri, int x, int y);
+    // keep the alpha mask and drop the CPU copy (the atlas holds the pixels now)
+    static void releasePixels(RawImage& ri);
+    // bring back the CPU copies of atlas images from the texture, before a repack
+    void restorePixelsFromAtlas();
     std::unordered_map<std::string, RawImage> rawImages;
+    // added to rawImages since the atlas was built; prepare() slots them into free space
+    std::vector<std::string> pendingImages;
+    // uploaded by this frame's commands: their CPU copies are released on the next
+    // prepare(), when the upload has been submitted, so a readback never misses them
+    std::vector<std::string> uploadedImages;
+    void releaseUploadedPixels();
+    // bytes of atlas inserts uploaded per frame; the rest wait for the next frame
+    size_t uploadBudget = size_t(4) << 20;
+
+    // Image files decode on worker threads: ensureImageLoaded queues the path and returns
+    // false until the image is in rawImages. Meanwhile lookups resolve to a placeholder.
+    std::unique_ptr<ImageLoader> imageLoader;
+    std::unordered_set<std::string> loadingImages; // requested, not decoded yet
+    std::unordered_set<std::string> shownAsPlaceholder; // decoded, waiting for atlas space
+    std::vector<ImageLoader::Decoded> decoded;    // scratch
+    static const char* const LOADING_IMAGE;        // rawImages/atlasMap key of the placeholder
 
-    bool ensureImageLoaded(const std::string& path); // loads into rawImages
-    void buildAtlasFromRawImages(); // pack & upload atlas; fills atlasMap
+    bool ensureImageLoaded(const std::string& path); // true once it is in rawImages
+    void addRawImage(const std::string& path, const RawImage& ri); // takes ownership of ri.pixels
+    void collectDecodedImages(); // move finished decodes into rawImages / pendingImages
+    // atlas rect for `path`; false (and the placeholder's rect) while it isn't in the
+    // atlas, in which case an evicted image is requested again
+    bool lookupSubTexture(const std::string& path, SubTexture& out);
+    // trim, dedupe, pack (MaxRects, largest first) & upload atlas pages; fills atlasMap
+    void buildAtlasFromRawImages();
+    // place pendingImages in the free space of the existing pages and upload just their
+    // rects, up to uploadBudget bytes; false when one doesn't fit (full or fragmented),
+    // the caller then rebuilds
+    bool insertPendingImages(renderPipeline* pipeline);
+    // the atlas half of prepare(): take finished decodes, evict, then build, insert or
+    // repack. Safe to repeat within a frame (prepare() itself runs once per frame)
+    void updateAtlas(renderPipeline* pipeline);
+
+    // an image reduced to its non-transparent box, with a hash of that content
+    struct TrimmedImage {
+        const std::string* path;
+        const RawImage* img;
+        int x, y, w, h;
+        uint64_t hash;
+    };
+    static TrimmedImage trimImage(const std::string& path, const RawImage& ri);
+    static bool sameContent(const TrimmedImage& a, const TrimmedImage& b);
+    SubTexture placedSubTexture(const TrimmedImage& t, const AtlasPacker::Slot& slot) const;
+
+    // the packer's free space outlives a build so later images can be inserted
+    AtlasPacker atlasPacker;
+    // one packed rect, shared by every path with the same trimmed content
+    struct AtlasRect {
+        uint64_t hash;
+        int imgW, imgH;       // source image size
+        int x, y, w, h;       // its trimmed box
+        AtlasPacker::Slot slot;
+        uint32_t paths = 0;   // atlasMap entries pointing at it
+        bool holds(const TrimmedImage& t) const {
+            // CPU pixels are gone by now, so content is matched by its 64-bit hash
+            return hash == t.hash && imgW == t.img->w && imgH == t.img->h &&
+                   x == t.x && y == t.y && w == t.w && h == t.h;
+        }
+    };
+    // atlas content by hash, to share rects with new images
+    std::unordered_map<uint64_t, std::vector<AtlasRect>> atlasContent;
+    size_t residentBytes = 0; // trimmed RGBA bytes of every AtlasRect
+
+    // Residency: retained users (e.g. IsometricLayer chunks) hold references, lookups
+    // stamp the frame. Over textureBudget, images without references that weren't used
+    // for EVICT_GRACE_FRAMES are evicted least recently used first.
+    struct Residency {
+        uint32_t refs = 0;
+        uint64_t lastUsed = 0;
+        uint64_t hash = 0; // of its AtlasRect
+    };
+    std::unordered_map<std::string, Residency> residency;
+    size_t textureBudget = 0;
+    uint64_t layerFrame = 0;     // prepare() calls
+    uint64_t nextEvictionScan = 0;
+    static const uint64_t EVICT_GRACE_FRAMES = 600;
+    static const uint64_t EVICT_SCAN_FRAMES = 30;
+    void acquireTexture(const std::string& path);
+    void releaseTexture(const std::string& path);
+    void evictUnused();
+    void evictImage(const std::string& path);
 
-    // helper: draw a set of interleaved verts (pos3, normal3, uv2) using texture
-    void drawVerts(renderPipeline* pipeline, const std::vector<float>& verts, unsigned int tex);
+    // helper: draw a set of interleaved verts (pos3, normal3, uv2) with this layer's atlas
+    // (plain verts sample its first page)
+    void drawVerts(renderPipeline* pipeline, const std::vector<float>& verts);
+    // helper: draw quads of four compact vertices each (a quarter of drawVerts' bytes)
+    void drawQuads(renderPipeline* pipeline, const std::vector<QuadVertex>& verts);
+    void drawStreamedQuads(renderPipeline* pipeline, size_t offset, size_t quads); // GL side
 };
 
 #endif // RENDER_LAYER_H
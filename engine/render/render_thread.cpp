@@ -0,0 +1,79 @@
+#include "engine/render/render_thread.h"
+#include "engine/render/renderm.h"
+#include <iostream>
+
+RenderThread::RenderThread(renderPipeline* pipeline, SDL_Window* window, SDL_GLContext context)
+    : pipeline(pipeline), window(window), context(context) {
+    // a context is current on one thread at a time
+    SDL_GL_MakeCurrent(window, nullptr);
+    thread = std::thread(&RenderThread::run, this);
+}
+
+RenderThread::~RenderThread() {
+    {
+        std::unique_lock<std::mutex> lock(mtx);
+        waitIdle(lock);
+        stopping = true;
+    }
+    cv.notify_all();
+    thread.join();
+    if (SDL_GL_MakeCurrent(window, context) != 0) {
+        std::cerr << "RenderThread: failed to take the GL context back: " << SDL_GetError() << "\n";
+    }
+    // recorded after the last submit (nothing was drawn for it): run it for its uploads
+    // and releases, so GL resources still go away in order
+    for (auto &cmd : recording().commands) cmd();
+    recording().clear();
+}
+
+void RenderThread::waitIdle(std::unique_lock<std::mutex>& lock) {
+    cv.wait(lock, [this]{ return !queued && !call && !busy; });
+}
+
+void RenderThread::submit() {
+    {
+        std::unique_lock<std::mutex> lock(mtx);
+        // the other packet is free to record into once the frame before has finished
+        waitIdle(lock);
+        queued = &packets[recordSlot];
+        recordSlot ^= 1;
+    }
+    cv.notify_all();
+}
+
+void RenderThread::invoke(const std::function<void()>& fn) {
+    std::unique_lock<std::mutex> lock(mtx);
+    waitIdle(lock);
+    call = &fn;
+    cv.notify_all();
+    cv.wait(lock, [this]{ return !call && !busy; });
+}
+
+void RenderThread::run() {
+    if (SDL_GL_MakeCurrent(window, context) != 0) {
+        std::cerr << "RenderThread: failed to make the GL context current: " << SDL_GetError() << "\n";
+    }
+    for (;;) {
+        FramePacket* packet = nullptr;
+        const std::function<void()>* fn = nullptr;
+        {
+            std::unique_lock<std::mutex> lock(mtx);
+            cv.wait(lock, [this]{ return stopping || queued || call; });
+            if (queued) packet = queued;
+            else if (call) fn = call;
+            else break; // stopping with nothing left
+            busy = true;
+        }
+        // commands are destroyed here too, so GL objects they own die on this thread
+        if (packet) pipeline->executePacket(*packet);
+        else (*fn)();
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            if (packet) queued = nullptr;
+            else call = nullptr;
+            busy = false;
+        }
+        cv.notify_all();
+    }
+    SDL_GL_MakeCurrent(window, nullptr);
+}
@@ -0,0 +1,52 @@
+#ifndef RENDER_THREAD_H
+#define RENDER_THREAD_H
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <SDL2/SDL.h>
+
+#include "engine/render/frame_packet.h"
+
+class renderPipeline;
+
+// Thread that owns the GL context and submits frame packets.
+//
+// Two packets: the main thread records frame N+1 into one while this thread executes
+// and swaps frame N from the other. submit() hands over the recorded packet; it only
+// waits when the previous one hasn't finished yet, which bounds the lag to one frame.
+// Constructing takes the context off the calling thread, destroying gives it back.
+class RenderThread {
+public:
+    RenderThread(renderPipeline* pipeline, SDL_Window* window, SDL_GLContext context);
+    ~RenderThread(); // finishes submitted work; the context is current on the caller again
+    RenderThread(const RenderThread&) = delete;
+    RenderThread& operator=(const RenderThread&) = delete;
+
+    FramePacket& recording() { return packets[recordSlot]; }
+    void submit();
+    // run fn on the render thread after everything submitted, and wait for it
+    void invoke(const std::function<void()>& fn);
+
+private:
+    void run();
+    void waitIdle(std::unique_lock<std::mutex>& lock);
+
+    renderPipeline* pipeline;
+    SDL_Window* window;
+    SDL_GLContext context;
+
+    FramePacket packets[2];
+    int recordSlot = 0;
+
+    std::thread thread;
+    std::mutex mtx;
+    std::condition_variable cv;
+    FramePacket* queued = nullptr;              // submitted, not started yet
+    const std::function<void()>* call = nullptr; // invoke() waiting to run
+    bool busy = false;                          // executing a packet or a call
+    bool stopping = false;
+};
+
+#endif // RENDER_THREAD_H
@@ -1,9 +1,57 @@
 #ifndef RENDER_TYPES_H
 #define RENDER_TYPES_H
 
+#include <cstdint>
+
 // Simple struct to hold a sub-rect in atlas (UV coords)
 struct SubTexture {
     float u0, v0, u1, v1;
+    int page = 0; // layer of the atlas texture array
+    // Part of the source image the rect holds, as fractions of its size: the atlas
+    // only stores what is left after trimming fully transparent borders
+    float x0 = 0.0f, y0 = 0.0f, x1 = 1.0f, y1 = 1.0f;
+};
+
+// One instanced sprite (36 bytes instead of 6 vertices x 8 floats). Positions are in
+// world space; default.vs projects them with the IsoView uniform block and expands the
+// quad, so camera movement needs no re-upload. Layout: renderPipeline::bindSpriteInstances.
+struct SpriteInstance {
+    float x, y, z;             // world position
+    uint32_t page;             // atlas page (texture array layer)
+    uint16_t u0, v0, u1, v1;   // atlas rect, normalized to 0..65535
+    uint32_t tint;             // RGBA8 (red in the low byte) multiplied into the texel
+    uint16_t crop[4];          // SubTexture x0 y0 x1 y1 (trimmed part of the image), normalized
+};
+static_assert(sizeof(SpriteInstance) == 36, "SpriteInstance must stay tightly packed");
+
+// Compact screen-space vertex (16 bytes instead of 8 floats). A quad is four of them,
+// drawn through the pipeline's shared quad index buffer. Layout: RenderLayer::drawQuads.
+struct QuadVertex {
+    int16_t x, y;              // virtual-resolution pixels
+    uint16_t u, v;             // atlas uv, normalized to 0..65535
+    uint32_t color;            // RGBA8 (red in the low byte) multiplied into the texel
+    uint32_t page;             // atlas page (texture array layer)
+};
+static_assert(sizeof(QuadVertex) == 16, "QuadVertex must stay tightly packed");
+
+// What default.vs reads (its `uFormat` uniform); each layer picks the one it draws with
+enum VertexFormat {
+    FLOAT_VERTS = 0,      // 8 floats per vertex (pos3, normal3, uv2), NDC: drawVerts
+    SPRITE_INSTANCES = 1, // SpriteInstance per sprite, projected with IsoView
+    QUAD_VERTS = 2,       // QuadVertex, 4 per quad: drawQuads
+};
+
+class Object;
+
+// Result of a screen-space pick. For tilemap hits `obj` is the map and
+// tileX/tileY the cell within it.
+struct PickResult {
+    Object* obj = nullptr;
+    bool isTile = false;
+    int tileX = 0;
+    int tileY = 0;
+
+    explicit operator bool() const { return obj != nullptr; }
 };
 
 #endif // RENDER_TYPES_H
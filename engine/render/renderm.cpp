@@ -1,9 +1,12 @@
 #include "engine/render/renderm.h"
 #include "engine/render/render_layer.h"
 #include "engine/render/isometric_layer.h"
+#include "engine/render/iso_projection.h"
+#include "engine/render/render_thread.h"
 #include "engine/foogui/foogui.h"
 #include <algorithm>
-#include <cstring> // memcpy
+#include <cstring> // memcpy, memcmp
+#include <cstddef> // offsetof
 
 // quadTemplate same as your version (posx,posy,posz, nx,ny,nz, u,v)
 const float renderPipeline::quadTemplate[6*8] = {
@@ -23,28 +26,92 @@ renderPipeline::renderPipeline(Engine* eng)
     // atlas size used by layers
     int layerAtlasSize = engine ? engine->atlas_size : 2048;
 
-    glEnable(GL_BLEND);
-    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-    glEnable(GL_DEPTH_TEST);
-    glDepthFunc(GL_LEQUAL);
+    glState::enable(GL_BLEND, true);
+    glState::blendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    glState::enable(GL_DEPTH_TEST, true);
+    glState::depthFunc(GL_LEQUAL);
+    glGetIntegerv(GL_MAX_ARRAY_TEXTURE_LAYERS, &maxLayers);
 
     // Don't abort if there's no Scene Manager; rendering can proceed without a camera
     if (!engine->sceneMgr) {
         std::cerr << "[renderPipeline] Warning: Scene manager not present; rendering may not be fully functional." << std::endl;
     }
 
-    // create empty VBO (we will allocate with update)
-    globalVBO = new vbo(nullptr, 0);
+    // streaming vertex ring shared by the layers (each upload gets its own region)
+    streamVBO = new streamBuffer();
+    pixelUnpack = new streamBuffer(size_t(1) << 20, GL_PIXEL_UNPACK_BUFFER);
+
+    // quad index pattern shared by instanced sprites and QuadVertex batches
+    std::vector<uint16_t> indices(QUAD_BATCH * 6);
+    for (size_t q = 0; q < QUAD_BATCH; ++q) {
+        const uint16_t base = uint16_t(q * 4);
+        const uint16_t pattern[6] = {0, 1, 2, 2, 3, 0};
+        for (int i = 0; i < 6; ++i) indices[q * 6 + i] = uint16_t(base + pattern[i]);
+    }
+    quadIndices = new retainedBuffer(GL_ELEMENT_ARRAY_BUFFER);
+    quadIndices->upload(indices.data(), indices.size() * sizeof(uint16_t));
+
+    // Attribute layouts are set once per VAO; draws only bind the VAO (the stream ring
+    // keeps its buffer name when it grows, so the pointers stay valid)
+    globalVAO.bind();
+    streamVBO->bindVertexLayout();
+    quadVAO.bind();
+    glState::bindBuffer(GL_ELEMENT_ARRAY_BUFFER, quadIndices->id());
+    glState::bindBuffer(GL_ARRAY_BUFFER, streamVBO->id());
+    const GLsizei QUAD_STRIDE = sizeof(QuadVertex);
+    glEnableVertexAttribArray(0); // pixel position
+    glVertexAttribPointer(0, 2, GL_SHORT, GL_FALSE, QUAD_STRIDE, (void*)offsetof(QuadVertex, x));
+    glEnableVertexAttribArray(2); // uv
+    glVertexAttribPointer(2, 2, GL_UNSIGNED_SHORT, GL_TRUE, QUAD_STRIDE, (void*)offsetof(QuadVertex, u));
+    glEnableVertexAttribArray(7); // color
+    glVertexAttribPointer(7, 4, GL_UNSIGNED_BYTE, GL_TRUE, QUAD_STRIDE, (void*)offsetof(QuadVertex, color));
+    glEnableVertexAttribArray(8); // atlas page
+    glVertexAttribIPointer(8, 1, GL_UNSIGNED_INT, QUAD_STRIDE, (void*)offsetof(QuadVertex, page));
+    // sprite instances: only the pointers move (bindSpriteInstances)
+    spriteVAO.bind();
+    glState::bindBuffer(GL_ELEMENT_ARRAY_BUFFER, quadIndices->id()); // the four corners of one quad
+    for (GLuint attrib : {3u, 4u, 5u, 6u, 9u}) {
+        glEnableVertexAttribArray(attrib);
+        glVertexAttribDivisor(attrib, 1);
+    }
+
+    // sampler on unit 0 for good; the vertex format is set per draw, only when it changes
+    glState::useProgram(defaultShader.ID);
+    glState::uniform1i(glGetUniformLocation(defaultShader.ID, "texture1"), 0);
+    formatLocation = glGetUniformLocation(defaultShader.ID, "uFormat");
+
+    // IsoView uniform block, bound to point 0 for every program that declares it
+    glGenBuffers(1, &viewUBO);
+    glState::bindBuffer(GL_UNIFORM_BUFFER, viewUBO);
+    glBufferData(GL_UNIFORM_BUFFER, sizeof(IsoProjection::Block), nullptr, GL_DYNAMIC_DRAW);
+    glBindBufferBase(GL_UNIFORM_BUFFER, 0, viewUBO);
+    GLuint viewIndex = glGetUniformBlockIndex(defaultShader.ID, "IsoView");
+    if (viewIndex != GL_INVALID_INDEX) glUniformBlockBinding(defaultShader.ID, viewIndex, 0);
 
     // default: add the existing isometric renderer as one layer
-    layers.emplace_back(std::make_unique<IsometricLayer>(engine, registry, layerAtlasSize));
+    addLayer(std::make_unique<IsometricLayer>(engine, registry, layerAtlasSize));
+    if (engine && engine->texture_budget_mb > 0) layers.back()->setTextureBudget(size_t(engine->texture_budget_mb) << 20);
 } 
 
 renderPipeline::~renderPipeline() {
+    // GL objects below (and the layers') are deleted on this thread
+    stopRenderThread();
     // Layers own their own raw images and textures and will clean up in their destructors
-    if (globalVBO) {
-        delete globalVBO;
-        globalVBO = nullptr;
+    if (streamVBO) {
+        delete streamVBO;
+        streamVBO = nullptr;
+    }
+    if (pixelUnpack) {
+        delete pixelUnpack;
+        pixelUnpack = nullptr;
+    }
+    if (quadIndices) {
+        delete quadIndices;
+        quadIndices = nullptr;
+    }
+    if (viewUBO) {
+        glState::deleteBuffer(viewUBO);
+        viewUBO = 0;
     }
 }
 
@@ -67,60 +134,140 @@ void renderPipeline::addTextToUI(const std::string& txt, float ndc_x, float ndc_
     std::cerr << "[renderPipeline] Warning: no GuiLayer found to add UI text" << std::endl;
 }
 
+PickResult renderPipeline::pick(int winX, int winY) const {
+    // window coordinates -> virtual resolution (the viewport stretches virt_sx x virt_sy over the window)
+    int winW = engine->virt_sx, winH = engine->virt_sy;
+    if (engine->getWindow()) SDL_GetWindowSize(engine->getWindow(), &winW, &winH);
+    if (winW <= 0 || winH <= 0) return PickResult{};
+    float px = (winX + 0.5f) * float(engine->virt_sx) / float(winW);
+    float py = (winY + 0.5f) * float(engine->virt_sy) / float(winH);
 
-// Append object vertices to world verts using the subtexture UVs and depth
-void renderPipeline::appendObjectToVerts(std::vector<float>& verts, const Object* obj, const SubTexture& uv, float zdepth) {
-    const int TILE_W = engine->tile_width;
-    const int TILE_H = engine->tile_height;
-    const int OFFSET_X = engine->virt_sx/2;
-    const int OFFSET_Y = engine->virt_sy/2;
+    // layers draw in order, so the last world layer with a hit is on top
+    PickResult hit;
+    for (auto &layer : layers) {
+        auto iso = dynamic_cast<const IsometricLayer*>(layer.get());
+        if (!iso) continue;
+        PickResult r = iso->pick(px, py);
+        if (r) hit = r;
+    }
+    return hit;
+}
 
-    // If a camera exists in the scene manager, offset world coordinates by it, otherwise use origin
-    float camX = 0.0f, camY = 0.0f, camZ = 0.0f;
-    if (engine && engine->sceneMgr && engine->sceneMgr->isCamera && engine->sceneMgr->camera) {
-        camX = engine->sceneMgr->camera->x;
-        camY = engine->sceneMgr->camera->y;
-        camZ = engine->sceneMgr->camera->z;
+void renderPipeline::addLayer(std::unique_ptr<RenderLayer> layer) {
+    if (layer) layer->owner = this;
+    layers.push_back(std::move(layer));
+}
+
+bool renderPipeline::startRenderThread() {
+    if (renderThread) return true;
+    if (!engine || !engine->getWindow() || !engine->getGLContext()) {
+        std::cerr << "[renderPipeline] No window or GL context; rendering stays on the main thread" << std::endl;
+        return false;
     }
+    renderThread = new RenderThread(this, engine->getWindow(), engine->getGLContext());
+    std::cout << "[renderPipeline] Rendering on a separate thread" << std::endl;
+    return true;
+}
 
-    float objX = obj->x - camX;
-    float objY = obj->y - camY;
-    float objZ = obj->z - camZ;
-
-    float screenXf = (objX - objY) * (TILE_W/2.0f) + OFFSET_X;
-    // Use the same projection math as the culling routine so culling matches rendering
-    float screenYf = (objX + objY) * (TILE_W / 6.4f) - (objZ * (TILE_H * 0.66f)) + OFFSET_Y;
-
-    int baseX = int(screenXf);
-    int baseY = int(screenYf);
-
-    for (int i = 0; i < 6; ++i) {
-        const float* v = &quadTemplate[i*8];
-        float px = baseX + v[0];
-        float py = baseY + v[1];
-
-        verts.push_back(screenToNDCx(int(px)));
-        verts.push_back(screenToNDCy(int(py)));
-        verts.push_back(zdepth);
-        verts.push_back(v[3]); // nx
-        verts.push_back(v[4]); // ny
-        verts.push_back(v[5]); // nz
-
-        // remap uv from [0..1] to atlas uv
-        float su = uv.u0 + v[6] * (uv.u1 - uv.u0);
-        float sv = uv.v0 + v[7] * (uv.v1 - uv.v0);
-        verts.push_back(su);
-        verts.push_back(sv);
+void renderPipeline::stopRenderThread() {
+    if (!renderThread) return;
+    delete renderThread;
+    renderThread = nullptr;
+}
+
+void renderPipeline::record(std::function<void()> cmd) {
+    if (renderThread) renderThread->recording().commands.push_back(std::move(cmd));
+    else cmd();
+}
+
+void renderPipeline::invoke(const std::function<void()>& fn) {
+    if (renderThread) renderThread->invoke(fn);
+    else fn();
+}
+
+void* renderPipeline::streamAlloc(size_t bytes, size_t align, StreamRef& ref) {
+    if (!renderThread) {
+        // inline: straight into the ring, no extra copy
+        ref.inPacket = false;
+        return streamVBO->map(bytes, align, ref.offset);
     }
+    std::vector<unsigned char> &stream = renderThread->recording().stream;
+    if (align == 0) align = 1;
+    ref.inPacket = true;
+    ref.offset = (stream.size() + align - 1) / align * align;
+    stream.resize(ref.offset + bytes);
+    return stream.data() + ref.offset;
 }
 
-// Main renderAll: dispatches to registered layers and performs final buffer swap once
-void renderPipeline::renderAll() {
-    if (!registry || registry->empty()) return;
+void renderPipeline::streamDone() {
+    if (!renderThread) streamVBO->unmap();
+}
 
+void renderPipeline::beginFrame(const IsoProjection::Block& view) {
     // Clear GL buffers once per frame
     glClearColor(0.2f, 0.3f, 0.3f, 1.0f);
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    updateViewUniforms(view);
+}
+
+void renderPipeline::endFrame() {
+    // this frame's streamed regions may be recycled once the GPU is done with them
+    streamVBO->endFrame();
+    pixelUnpack->endFrame();
+
+    // Swap buffers once after all layers rendered
+    SDL_GL_SwapWindow(engine->getWindow());
+}
+
+void renderPipeline::executePacket(FramePacket& packet) {
+    beginFrame(packet.view);
+    // the whole frame's vertex and instance data in one ring upload
+    packetStreamBase = packet.stream.empty() ? 0 : streamVBO->upload(packet.stream.data(), packet.stream.size(), FramePacket::ALIGN);
+    for (auto &cmd : packet.commands) cmd();
+    endFrame();
+    packet.clear();
+}
+
+void renderPipeline::updateViewUniforms(const IsoProjection::Block& b) {
+    if (viewUploaded && memcmp(&b, &viewBlock, sizeof(b)) == 0) return;
+    viewBlock = b;
+    viewUploaded = true;
+    glState::bindBuffer(GL_UNIFORM_BUFFER, viewUBO);
+    glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(b), &b);
+}
+
+void renderPipeline::bindSpriteInstances(unsigned int buffer, size_t offset) {
+    // GL 3.3 has no base instance, so the region offset goes into the attribute pointers
+    const GLsizei STRIDE = sizeof(SpriteInstance);
+    spriteVAO.bind();
+    // arrays, divisors and the index buffer are set up once in the constructor
+    if (glState::attributesAt(buffer, offset, 5)) return;
+    glState::bindBuffer(GL_ARRAY_BUFFER, buffer);
+    // world x, y, z
+    glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, STRIDE, (void*)(offset + offsetof(SpriteInstance, x)));
+    // atlas page
+    glVertexAttribIPointer(4, 1, GL_UNSIGNED_INT, STRIDE, (void*)(offset + offsetof(SpriteInstance, page)));
+    // atlas rect
+    glVertexAttribPointer(5, 4, GL_UNSIGNED_SHORT, GL_TRUE, STRIDE, (void*)(offset + offsetof(SpriteInstance, u0)));
+    // tint
+    glVertexAttribPointer(6, 4, GL_UNSIGNED_BYTE, GL_TRUE, STRIDE, (void*)(offset + offsetof(SpriteInstance, tint)));
+    // trimmed part of the image
+    glVertexAttribPointer(9, 4, GL_UNSIGNED_SHORT, GL_TRUE, STRIDE, (void*)(offset + offsetof(SpriteInstance, crop)));
+}
+
+void renderPipeline::useShader(VertexFormat format) {
+    glState::useProgram(defaultShader.ID);
+    glState::uniform1i(formatLocation, format);
+}
+
+// Main renderAll: dispatches to registered layers and performs final buffer swap once
+void renderPipeline::renderAll() {
+    if (!registry || registry->empty()) return;
+
+    // camera / projection for this frame (GPU side of IsoProjection)
+    const IsoProjection::Block view = IsoProjection::fromEngine(engine).block(engine->virt_sx, engine->virt_sy);
+    if (renderThread) renderThread->recording().view = view;
+    else beginFrame(view);
 
     // Prepare and render each layer in order
     for (auto &layer : layers) {
@@ -129,8 +276,9 @@ void renderPipeline::renderAll() {
         layer->render(this);
     }
 
-    // Swap buffers once after all layers rendered
-    SDL_GL_SwapWindow(engine->getWindow());
+    // threaded: the render thread submits and swaps while the next frame is simulated
+    if (renderThread) renderThread->submit();
+    else endFrame();
 }
 
 // request full atlas rebuild on all layers
@@ -6,12 +6,15 @@
 #include <memory>
 #include <string>
 #include <iostream>
+#include <functional>
 
 #include "engine/obj/obj.h"
 #include "engine/enginem.h"
 #include "engine/render/glAbstract.h"
 #include "incl/learnopengl/shader_s.h"
 #include "engine/render/render_types.h"
+#include "engine/render/iso_projection.h"
+#include "engine/render/frame_packet.h"
 
 // NOTE: RenderLayer and IsometricLayer are defined in separate headers
 #include "engine/render/render_layer.h"
@@ -19,6 +22,7 @@
 
 class RenderLayer;
 class IsometricLayer;
+class RenderThread;
 
 struct TileBatch {
      std::vector<float> verts; vbo* VBO = nullptr;
@@ -34,6 +38,7 @@ class renderPipeline {
 public:
     friend class RenderLayer;
     friend class IsometricLayer;
+    friend class RenderThread;
 
     explicit renderPipeline(Engine* eng);
     ~renderPipeline();
@@ -42,16 +47,41 @@ public:
     void rainbowTriangle();
 
     // register external layers
-    void addLayer(std::unique_ptr<RenderLayer> layer) { layers.push_back(std::move(layer)); }
+    void addLayer(std::unique_ptr<RenderLayer> layer);
+
+    // Move GL submission to a render thread that owns the context (see docs/render.md);
+    // renderAll() then records frame packets and returns without waiting for the GPU.
+    bool startRenderThread();
+    // finish submitted frames and take the context back on this thread
+    void stopRenderThread();
+    bool threaded() const { return renderThread != nullptr; }
+
+    // GL work from the layers: runs at once, or goes into the frame packet when a render
+    // thread submits. Commands must own (capture by value) everything they read.
+    void record(std::function<void()> cmd);
+    // run fn where GL is current, after everything recorded so far, and wait (readbacks)
+    void invoke(const std::function<void()>& fn);
+    // Space for `bytes` of this frame's streamed vertex data: the mapped stream ring, or
+    // the packet's stream when threaded. Write it, call streamDone(), then read the
+    // buffer offset with streamOffset() inside the command that draws from it.
+    void* streamAlloc(size_t bytes, size_t align, StreamRef& ref);
+    void streamDone();
+    size_t streamOffset(const StreamRef& ref) const { return ref.inPacket ? packetStreamBase + ref.offset : ref.offset; }
+
+    // GL_MAX_ARRAY_TEXTURE_LAYERS, queried once so layers never ask GL off its thread
+    int maxArrayLayers() const { return maxLayers; }
 
     // core OpenGL abstractions
     glTile obj2gl(const Object* obj); // kept for compatibility if needed
     float screenToNDCx(int screenX);
     float screenToNDCy(int screenY);
 
-    // manually rebuild atlas (call if you add sprites after start)
+    // manually repack every layer's atlas (new images are inserted on their own)
     void rebuildAtlas();
 
+    // topmost world sprite under a window-space point (e.g. mouse click coordinates)
+    PickResult pick(int winX, int winY) const;
+
     // convenience: add text to the UI layer (NDC coords)
     void addTextToUI(const std::string& txt, float ndc_x, float ndc_y, const std::string& font = "", int pxSize = 24, bool persistent = false);
 
@@ -59,9 +89,44 @@ private:
     Engine* engine = nullptr;
     Shader defaultShader;
 
-    // single VAO/VBO for the whole world
+    // single VAO for the whole world; per-frame vertices are streamed through a ring buffer
     vao globalVAO;
-    vbo* globalVBO = nullptr;
+    streamBuffer* streamVBO = nullptr;
+    // pixel unpack ring staging atlas inserts (RenderLayer::insertPendingImages)
+    streamBuffer* pixelUnpack = nullptr;
+    // instanced sprites: per-instance attributes only, read from the stream ring
+    vao spriteVAO;
+    // point the sprite VAO's instance attributes at SpriteInstance records at `offset` in `buffer`
+    // (the stream ring or a layer's retained buffer)
+    void bindSpriteInstances(unsigned int buffer, size_t offset);
+    // defaultShader drawing `format` (sampler and uniform locations are set up once)
+    void useShader(VertexFormat format);
+    GLint formatLocation = -1;
+
+    // Shared index buffer for quads of four vertices (0 1 2, 2 3 0, then +4 per quad).
+    // 16-bit indices, so one draw covers at most QUAD_BATCH quads; longer runs are split
+    // and use base vertex offsets.
+    static const size_t QUAD_BATCH = 16384;
+    retainedBuffer* quadIndices = nullptr;
+    // compact QuadVertex layout read from the stream ring (see RenderLayer::drawQuads)
+    vao quadVAO;
+
+    // IsoView uniform block (camera, projection, virtual resolution), binding point 0.
+    // Re-uploaded only when the view changes, so panning costs one 64-byte update.
+    unsigned int viewUBO = 0;
+    IsoProjection::Block viewBlock{};
+    bool viewUploaded = false;
+    void updateViewUniforms(const IsoProjection::Block& b);
+
+    // frame boundaries where GL is current: clear + view uniforms, then fences + swap
+    void beginFrame(const IsoProjection::Block& view);
+    void endFrame();
+    // on the render thread: upload the packet's stream, run and drop its commands
+    void executePacket(FramePacket& packet);
+
+    RenderThread* renderThread = nullptr;
+    size_t packetStreamBase = 0; // ring offset of the packet being executed
+    int maxLayers = 0;
 
     // Layer abstraction: each layer may manage its own atlas/images and rendering rules
 
@@ -71,11 +136,8 @@ private:
     // objects registry (used by default isometric layer)
     std::vector<std::unique_ptr<Object>>* registry = nullptr;
 
-    // template for a quad (unchanged)
+    // template for a quad (unchanged); default.vs expands instances with the same corners
     static const float quadTemplate[6*8];
-
-    // helper functions
-    void appendObjectToVerts(std::vector<float>& verts, const Object* obj, const SubTexture& uv, float zdepth);
 };
 
 #endif // RENDERM_H
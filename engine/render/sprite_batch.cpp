@@ -0,0 +1,208 @@
+#include "engine/render/sprite_batch.h"
+
+#if defined(__GNUC__) && defined(__x86_64__)
+#define SPRITE_BATCH_X86 1
+#include <immintrin.h>
+#endif
+
+namespace {
+
+// int(v) where defined; out-of-range (and NaN) becomes INT32_MIN like cvttps does
+inline int32_t truncate(float v) {
+    if (!(v >= -2147483648.0f && v < 2147483648.0f)) return INT32_MIN;
+    return int32_t(v);
+}
+
+inline void projectOne(const IsoProjection& p, float x, float y, float z, int32_t& left, int32_t& top) {
+    left = truncate(p.screenX(x, y));
+    top = truncate(p.screenY(x, y, z));
+}
+
+inline bool onScreen(int32_t left, int32_t top, int viewW, int viewH) {
+    // written without `left + SPRITE_W` so INT32_MIN can't overflow
+    return left >= -IsoProjection::SPRITE_W && left <= viewW &&
+           top >= -IsoProjection::SPRITE_H && top <= viewH;
+}
+
+void projectScalar(const IsoProjection& p, const float* x, const float* y, const float* z,
+                   size_t n, int32_t* left, int32_t* top) {
+    for (size_t i = 0; i < n; ++i) projectOne(p, x[i], y[i], z[i], left[i], top[i]);
+}
+
+size_t cullScalar(const IsoProjection& p, const float* x, const float* y, const float* z,
+                  size_t n, int viewW, int viewH, uint32_t* out, size_t from = 0) {
+    size_t count = 0;
+    for (size_t i = from; i < n; ++i) {
+        int32_t left, top;
+        projectOne(p, x[i], y[i], z[i], left, top);
+        if (onScreen(left, top, viewW, viewH)) out[count++] = uint32_t(i);
+    }
+    return count;
+}
+
+#ifdef SPRITE_BATCH_X86
+
+// SSE2 is part of x86-64, so these need no target attribute there
+struct Sse2 {
+    __m128 camX, camY, camZ, halfW, diagH, heightH, offX, offY;
+    __m128i minL, maxL, minT, maxT;
+
+    Sse2(const IsoProjection& p, int viewW, int viewH)
+        : camX(_mm_set1_ps(p.camX)), camY(_mm_set1_ps(p.camY)), camZ(_mm_set1_ps(p.camZ)),
+          halfW(_mm_set1_ps(p.halfW)), diagH(_mm_set1_ps(p.diagH)), heightH(_mm_set1_ps(p.heightH)),
+          offX(_mm_set1_ps(p.offsetX)), offY(_mm_set1_ps(p.offsetY)),
+          minL(_mm_set1_epi32(-IsoProjection::SPRITE_W)), maxL(_mm_set1_epi32(viewW)),
+          minT(_mm_set1_epi32(-IsoProjection::SPRITE_H)), maxT(_mm_set1_epi32(viewH)) {}
+
+    // same operation order as IsoProjection::screenX / screenY
+    void project(const float* x, const float* y, const float* z, __m128i& left, __m128i& top) const {
+        __m128 dx = _mm_sub_ps(_mm_loadu_ps(x), camX);
+        __m128 dy = _mm_sub_ps(_mm_loadu_ps(y), camY);
+        __m128 dz = _mm_sub_ps(_mm_loadu_ps(z), camZ);
+        __m128 sx = _mm_add_ps(_mm_mul_ps(_mm_sub_ps(dx, dy), halfW), offX);
+        __m128 sy = _mm_add_ps(_mm_sub_ps(_mm_mul_ps(_mm_add_ps(dx, dy), diagH), _mm_mul_ps(dz, heightH)), offY);
+        left = _mm_cvttps_epi32(sx);
+        top = _mm_cvttps_epi32(sy);
+    }
+    int visibleMask(__m128i left, __m128i top) const {
+        __m128i out = _mm_or_si128(_mm_or_si128(_mm_cmplt_epi32(left, minL), _mm_cmpgt_epi32(left, maxL)),
+                                   _mm_or_si128(_mm_cmplt_epi32(top, minT), _mm_cmpgt_epi32(top, maxT)));
+        return ~_mm_movemask_ps(_mm_castsi128_ps(out)) & 0xF;
+    }
+};
+
+void projectSse2(const IsoProjection& p, const float* x, const float* y, const float* z,
+                 size_t n, int32_t* left, int32_t* top) {
+    const Sse2 k(p, 0, 0);
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m128i l, t;
+        k.project(x + i, y + i, z + i, l, t);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(left + i), l);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(top + i), t);
+    }
+    projectScalar(p, x + i, y + i, z + i, n - i, left + i, top + i);
+}
+
+size_t cullSse2(const IsoProjection& p, const float* x, const float* y, const float* z,
+                size_t n, int viewW, int viewH, uint32_t* out) {
+    const Sse2 k(p, viewW, viewH);
+    size_t count = 0, i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m128i l, t;
+        k.project(x + i, y + i, z + i, l, t);
+        for (int mask = k.visibleMask(l, t); mask; mask &= mask - 1) {
+            out[count++] = uint32_t(i + __builtin_ctz(mask));
+        }
+    }
+    return count + cullScalar(p, x, y, z, n, viewW, viewH, out + count, i);
+}
+
+__attribute__((target("avx2")))
+inline void projectAvx2(const __m256 (&c)[8], const float* x, const float* y, const float* z, __m256i& left, __m256i& top) {
+    __m256 dx = _mm256_sub_ps(_mm256_loadu_ps(x), c[0]);
+    __m256 dy = _mm256_sub_ps(_mm256_loadu_ps(y), c[1]);
+    __m256 dz = _mm256_sub_ps(_mm256_loadu_ps(z), c[2]);
+    __m256 sx = _mm256_add_ps(_mm256_mul_ps(_mm256_sub_ps(dx, dy), c[3]), c[6]);
+    __m256 sy = _mm256_add_ps(_mm256_sub_ps(_mm256_mul_ps(_mm256_add_ps(dx, dy), c[4]), _mm256_mul_ps(dz, c[5])), c[7]);
+    left = _mm256_cvttps_epi32(sx);
+    top = _mm256_cvttps_epi32(sy);
+}
+
+// camX, camY, camZ, halfW, diagH, heightH, offsetX, offsetY
+__attribute__((target("avx2")))
+void avx2Constants(const IsoProjection& p, __m256 (&c)[8]) {
+    c[0] = _mm256_set1_ps(p.camX); c[1] = _mm256_set1_ps(p.camY); c[2] = _mm256_set1_ps(p.camZ);
+    c[3] = _mm256_set1_ps(p.halfW); c[4] = _mm256_set1_ps(p.diagH); c[5] = _mm256_set1_ps(p.heightH);
+    c[6] = _mm256_set1_ps(p.offsetX); c[7] = _mm256_set1_ps(p.offsetY);
+}
+
+__attribute__((target("avx2")))
+void projectAvx2(const IsoProjection& p, const float* x, const float* y, const float* z,
+                 size_t n, int32_t* left, int32_t* top) {
+    __m256 c[8];
+    avx2Constants(p, c);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256i l, t;
+        projectAvx2(c, x + i, y + i, z + i, l, t);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(left + i), l);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(top + i), t);
+    }
+    projectScalar(p, x + i, y + i, z + i, n - i, left + i, top + i);
+}
+
+__attribute__((target("avx2")))
+size_t cullAvx2(const IsoProjection& p, const float* x, const float* y, const float* z,
+                size_t n, int viewW, int viewH, uint32_t* out) {
+    __m256 c[8];
+    avx2Constants(p, c);
+    // visible: left in [-SPRITE_W, viewW], top in [-SPRITE_H, viewH]
+    const __m256i minL = _mm256_set1_epi32(-IsoProjection::SPRITE_W - 1), maxL = _mm256_set1_epi32(viewW);
+    const __m256i minT = _mm256_set1_epi32(-IsoProjection::SPRITE_H - 1), maxT = _mm256_set1_epi32(viewH);
+    size_t count = 0, i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256i l, t;
+        projectAvx2(c, x + i, y + i, z + i, l, t);
+        __m256i in = _mm256_andnot_si256(_mm256_cmpgt_epi32(l, maxL), _mm256_cmpgt_epi32(l, minL));
+        in = _mm256_and_si256(in, _mm256_andnot_si256(_mm256_cmpgt_epi32(t, maxT), _mm256_cmpgt_epi32(t, minT)));
+        for (int mask = _mm256_movemask_ps(_mm256_castsi256_ps(in)); mask; mask &= mask - 1) {
+            out[count++] = uint32_t(i + __builtin_ctz(mask));
+        }
+    }
+    return count + cullScalar(p, x, y, z, n, viewW, viewH, out + count, i);
+}
+
+#endif // SPRITE_BATCH_X86
+
+enum Isa { SCALAR, SSE2, AVX2 };
+
+Isa detect() {
+#ifdef SPRITE_BATCH_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) return AVX2;
+    if (__builtin_cpu_supports("sse2")) return SSE2;
+#endif
+    return SCALAR;
+}
+
+Isa active() {
+    static const Isa isa = detect();
+    return isa;
+}
+
+} // namespace
+
+namespace SpriteBatch {
+
+void project(const IsoProjection& proj, const float* x, const float* y, const float* z,
+             size_t n, int32_t* left, int32_t* top) {
+    switch (active()) {
+#ifdef SPRITE_BATCH_X86
+    case AVX2: projectAvx2(proj, x, y, z, n, left, top); return;
+    case SSE2: projectSse2(proj, x, y, z, n, left, top); return;
+#endif
+    default: projectScalar(proj, x, y, z, n, left, top); return;
+    }
+}
+
+size_t cull(const IsoProjection& proj, const float* x, const float* y, const float* z,
+            size_t n, int viewW, int viewH, uint32_t* out) {
+    switch (active()) {
+#ifdef SPRITE_BATCH_X86
+    case AVX2: return cullAvx2(proj, x, y, z, n, viewW, viewH, out);
+    case SSE2: return cullSse2(proj, x, y, z, n, viewW, viewH, out);
+#endif
+    default: return cullScalar(proj, x, y, z, n, viewW, viewH, out);
+    }
+}
+
+const char* isa() {
+    switch (active()) {
+    case AVX2: return "avx2";
+    case SSE2: return "sse2";
+    default: return "scalar";
+    }
+}
+
+} // namespace SpriteBatch
@@ -0,0 +1,30 @@
+#ifndef SPRITE_BATCH_H
+#define SPRITE_BATCH_H
+
+#include <cstddef>
+#include <cstdint>
+
+#include "iso_projection.h"
+
+// Batched IsoProjection for arrays of world positions (one array per coordinate).
+//
+// The kernels run 8 sprites at a time with AVX2 or 4 with SSE2, picked once at startup
+// from what the CPU reports, with a scalar fallback everywhere else. Each lane does the
+// same float operations in the same order as IsoProjection::spriteX/spriteY (no FMA, no
+// reassociation) and truncates the same way, so results are bit-identical to the scalar
+// calls. Positions whose projection doesn't fit an int are never reported visible.
+namespace SpriteBatch {
+    // left[i] = proj.spriteX(x[i], y[i]), top[i] = proj.spriteY(x[i], y[i], z[i])
+    void project(const IsoProjection& proj, const float* x, const float* y, const float* z,
+                 size_t n, int32_t* left, int32_t* top);
+
+    // Write the indices of sprites whose quad touches the viewW x viewH virtual screen
+    // to `out` (room for n), in input order; returns how many were written
+    size_t cull(const IsoProjection& proj, const float* x, const float* y, const float* z,
+                size_t n, int viewW, int viewH, uint32_t* out);
+
+    // "avx2", "sse2" or "scalar"
+    const char* isa();
+}
+
+#endif // SPRITE_BATCH_H
@@ -0,0 +1,96 @@
+#include "engine/render/sprite_sort.h"
+#include <algorithm>
+#include <barrier>
+#include <thread>
+
+void RadixSorter::sort(std::vector<Item>& items) {
+    const size_t n = items.size();
+    if (n < 2) return;
+    if (n < SMALL) {
+        std::stable_sort(items.begin(), items.end(), [](const Item& a, const Item& b){ return a.key < b.key; });
+        return;
+    }
+
+    unsigned threads = 1;
+    if (n >= PARALLEL_MIN) {
+        unsigned hw = maxThreads ? maxThreads : std::min(std::thread::hardware_concurrency(), 8u);
+        threads = std::max(1u, std::min<unsigned>(hw, unsigned(n / (PARALLEL_MIN / 4))));
+    }
+    scratch.resize(n);
+    counts.assign(size_t(threads) * 256, 0);
+
+    Item* src = items.data();
+    Item* dst = scratch.data();
+    const size_t block = (n + threads - 1) / threads;
+    bool skip = false;
+
+    // Between counting and scattering: per-thread digit counts -> scatter offsets.
+    // Thread t's keys with digit d go after every smaller digit and after the keys
+    // with digit d from threads before t, which keeps the sort stable.
+    auto prefix = [&]() {
+        skip = false;
+        for (int d = 0; d < 256 && !skip; ++d) {
+            size_t digitTotal = 0;
+            for (unsigned t = 0; t < threads; ++t) digitTotal += counts[t * 256 + d];
+            skip = digitTotal == n; // every key has this digit: the pass would be a copy
+        }
+        if (skip) return;
+        size_t total = 0;
+        for (int d = 0; d < 256; ++d) {
+            for (unsigned t = 0; t < threads; ++t) {
+                size_t c = counts[t * 256 + d];
+                counts[t * 256 + d] = total;
+                total += c;
+            }
+        }
+    };
+    // After scattering: the output becomes the next pass's input
+    auto flip = [&]() {
+        if (!skip) std::swap(src, dst);
+    };
+
+    auto count = [&](unsigned t, int shift) {
+        const size_t begin = std::min(n, t * block), end = std::min(n, begin + block);
+        size_t* c = &counts[size_t(t) * 256];
+        std::fill(c, c + 256, size_t(0));
+        for (size_t i = begin; i < end; ++i) ++c[(src[i].key >> shift) & 0xFF];
+    };
+    auto scatter = [&](unsigned t, int shift) {
+        if (skip) return;
+        const size_t begin = std::min(n, t * block), end = std::min(n, begin + block);
+        size_t* c = &counts[size_t(t) * 256];
+        for (size_t i = begin; i < end; ++i) dst[c[(src[i].key >> shift) & 0xFF]++] = src[i];
+    };
+
+    if (threads == 1) {
+        for (int shift = 0; shift < 64; shift += 8) {
+            count(0, shift);
+            prefix();
+            scatter(0, shift);
+            flip();
+        }
+    } else {
+        // two barrier phases per pass; the completion step runs on one thread in between
+        bool afterCount = true;
+        auto step = [&]() noexcept {
+            if (afterCount) prefix(); else flip();
+            afterCount = !afterCount;
+        };
+        std::barrier sync(std::ptrdiff_t(threads), step);
+        auto run = [&](unsigned t) {
+            for (int shift = 0; shift < 64; shift += 8) {
+                count(t, shift);
+                sync.arrive_and_wait();
+                scatter(t, shift);
+                sync.arrive_and_wait();
+            }
+        };
+        std::vector<std::thread> workers;
+        workers.reserve(threads - 1);
+        for (unsigned t = 1; t < threads; ++t) workers.emplace_back(run, t);
+        run(0);
+        for (auto &w : workers) w.join();
+    }
+
+    if (src != items.data()) std::copy(src, src + n, items.data());
+}
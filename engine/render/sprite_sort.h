@@ -0,0 +1,95 @@
+#ifndef SPRITE_SORT_H
+#define SPRITE_SORT_H
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Painter order for world sprites as one packed 64-bit key, so sorting compares
+// integers in a contiguous array instead of floats behind object pointers.
+//
+//   bits 63..50  z      (1/32 cell steps, biased)
+//   bits 49..37  chunk row     (y / CHUNK)
+//   bits 36..24  chunk column  (x / CHUNK)
+//   bits 23..14  y within the chunk (1/32 cell steps)
+//   bits 13..4   x within the chunk
+//   bits  3..0   layer (tiles below objects at the same spot)
+//
+// Coordinates are quantized to 1/32 of a cell and clamped to about +/-131072 cells
+// (z: +/-256). The top 40 bits are the chunk a sprite belongs to, so every chunk of
+// IsometricLayer is one contiguous range of the order.
+//
+// This is not quite the plain (z, y, x) painter order: within a band of chunk rows the
+// chunk column wins over y. Rows follow y, so only a column seam differs, and only for
+// sprites that overlap across it: (31.9, 10.5) sorts before (32.0, 10.0), which plain
+// order draws first. Tiles sit on whole cells of one chunk and never do; objects at
+// fractional positions next to a seam can. Accepted in exchange for chunks being ranges.
+namespace PaintKey {
+    const int STEPS = 32;          // quantization steps per cell
+    const int CHUNK = 32;          // cells per chunk edge
+    const int CELL_BITS = 10;      // log2(STEPS * CHUNK)
+    const int CHUNK_BITS = 13;
+    const int Z_BITS = 14;
+    const int LAYER_BITS = 4;
+    const int CHUNK_SHIFT = 24;    // key >> CHUNK_SHIFT = chunk id (z, row, column)
+
+    enum Layer : uint64_t { TILE = 0, OBJECT = 1 };
+
+    inline uint64_t quantize(float v, int bits) {
+        const int64_t bias = int64_t(1) << (bits - 1);
+        float q = std::floor(v * float(STEPS));
+        if (!(q >= -float(bias))) return 0; // also NaN
+        if (q >= float(bias)) return (uint64_t(1) << bits) - 1;
+        return uint64_t(int64_t(q) + bias);
+    }
+
+    inline uint64_t make(float x, float y, float z, Layer layer) {
+        const int POS_BITS = CHUNK_BITS + CELL_BITS;
+        const uint64_t CELL_MASK = (uint64_t(1) << CELL_BITS) - 1;
+        uint64_t zq = quantize(z, Z_BITS), yq = quantize(y, POS_BITS), xq = quantize(x, POS_BITS);
+        return (zq << 50) | ((yq >> CELL_BITS) << 37) | ((xq >> CELL_BITS) << 24) |
+               ((yq & CELL_MASK) << 14) | ((xq & CELL_MASK) << 4) | uint64_t(layer);
+    }
+
+    // Chunk id for cell-aligned chunk coordinates (what make() puts in the top bits)
+    inline uint64_t chunk(float z, int cy, int cx) {
+        const int64_t bias = int64_t(1) << (CHUNK_BITS - 1);
+        auto clampChunk = [&](int c) {
+            int64_t v = int64_t(c) + bias;
+            return uint64_t(v < 0 ? 0 : (v >= 2 * bias ? 2 * bias - 1 : v));
+        };
+        return (quantize(z, Z_BITS) << 26) | (clampChunk(cy) << 13) | clampChunk(cx);
+    }
+    inline uint64_t zOf(uint64_t key) { return key >> 50; } // quantized z, comparable across keys
+    inline int chunkRow(uint64_t chunkId) { return int((chunkId >> 13) & 0x1FFF) - (1 << (CHUNK_BITS - 1)); }
+    inline int chunkCol(uint64_t chunkId) { return int(chunkId & 0x1FFF) - (1 << (CHUNK_BITS - 1)); }
+    // lowest z of the chunk's 1/32 step
+    inline float chunkZ(uint64_t chunkId) { return (float(int64_t(chunkId >> 26)) - float(int64_t(1) << (Z_BITS - 1))) / float(STEPS); }
+}
+
+// Stable LSD radix sort of (key, index) pairs, 8 bits per pass. Passes whose digit is
+// the same for every key are skipped, and large inputs are split across threads
+// (per-thread histograms, one shared prefix sum per pass). Buffers are kept between
+// calls, so steady-state sorting does not allocate.
+class RadixSorter {
+public:
+    struct Item {
+        uint64_t key;
+        uint32_t index; // caller's payload position
+    };
+
+    // sort `items` by key; equal keys keep their relative order
+    void sort(std::vector<Item>& items);
+
+    // inputs below this use one thread; below SMALL a comparison sort is used
+    static const size_t PARALLEL_MIN = size_t(1) << 16;
+    static const size_t SMALL = 256;
+    unsigned maxThreads = 0; // 0 = hardware concurrency (capped at 8)
+
+private:
+    std::vector<Item> scratch;
+    std::vector<size_t> counts; // [thread][256]
+};
+
+#endif // SPRITE_SORT_H
@@ -1,9 +1,10 @@
 #include "engine/render/texture.h"
+#include "engine/render/glAbstract.h"
 #include <iostream>
 
 Texture::Texture(const std::string filename){
     glGenTextures(1, &texture);
-    glBindTexture(GL_TEXTURE_2D, texture); // all upcoming GL_TEXTURE_2D operations now have effect on this texture object
+    glState::bindTexture(GL_TEXTURE_2D, texture); // all upcoming GL_TEXTURE_2D operations now have effect on this texture object
     // set the texture wrapping parameters
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);	// set texture wrapping to GL_REPEAT (default wrapping method)
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
@@ -17,6 +18,7 @@ Texture::Texture(const std::string filename){
 
     if (data)
     {
+        glState::bindBuffer(GL_PIXEL_UNPACK_BUFFER, 0); // data is client memory
         glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, data);
         glGenerateMipmap(GL_TEXTURE_2D);
     }
@@ -28,6 +30,6 @@ Texture::Texture(const std::string filename){
 }
 
 void Texture::bind(){
-    glBindTexture(GL_TEXTURE_2D, texture);
+    glState::bindTexture(GL_TEXTURE_2D, texture);
 }
    
\ No newline at end of file
@@ -23,6 +23,8 @@ public:
     Scene_OBJ() {
         obj_class = "scene"; // set the obj_class
         invis = true;
+        // registered so snapshots keep the scene name
+        registerStringProperty("scnName", scnName);
     }
 };
 
@@ -2,6 +2,7 @@
 #include "game/engine_api.h"
 #include "game/main.h"
 #include "engine/scene/scene_oclass.h"
+#include "engine/tile/tilemap_oclass.h"
 #include <sstream>
 #include <memory>
 #include <stdexcept>
@@ -405,6 +406,45 @@ static void write_object_recursive(std::ostream &out, Object *obj, Object *scene
         return;
     }
 
+    // Tilemaps: size plus one run-length encoded row per non-empty line of tiles
+    if (auto *map = dynamic_cast<TileMap_OBJ*>(obj)) {
+        out << indent_str << "OBJECT " << obj->objName << " " << fullcls << " " << std::fixed << std::setprecision(3) << rx << " " << ry << " " << rz << "\n";
+        out << std::defaultfloat;
+        out << indent_str << "[\n";
+        out << indent_str << "    width " << map->getWidth() << ";\n";
+        out << indent_str << "    height " << map->getHeight() << ";\n";
+        const auto &palette = map->getPalette();
+        auto nameOf = [&](TileMap_OBJ::TileId id) -> std::string { return id ? palette[id - 1] : std::string("."); };
+        for (int ty = 0; ty < map->getHeight(); ++ty) {
+            std::ostringstream row;
+            bool any = false;
+            int tx = 0;
+            while (tx < map->getWidth()) {
+                TileMap_OBJ::TileId id = map->getTile(tx, ty);
+                int run = 1;
+                while (tx + run < map->getWidth() && map->getTile(tx + run, ty) == id) ++run;
+                if (!id && tx + run >= map->getWidth()) break; // trailing empty cells
+                any = true;
+                row << " " << nameOf(id);
+                if (run > 1) row << "*" << run;
+                tx += run;
+            }
+            if (any) out << indent_str << "    row \"" << ty << row.str() << "\";\n";
+        }
+        out << indent_str << "]";
+        if (children.empty()) {
+            out << ";\n";
+        } else {
+            out << "\n";
+            out << indent_str << "{\n";
+            for (auto *c : children) {
+                write_object_recursive(out, c, sceneRoot, indent+4);
+            }
+            out << indent_str << "};\n";
+        }
+        return;
+    }
+
     if (children.empty()) {
         out << indent_str << "OBJECT " << fullcls << " " << std::fixed << std::setprecision(3) << rx << " " << ry << " " << rz << ";\n";
         out << std::defaultfloat;
@@ -475,4 +515,91 @@ sceneData sceneManager::saveScene(const std::string& sceneName){
     out.close();
 
     return sData;
-}
\ No newline at end of file
+}
+// Scene-manager state appended after the object snapshot: camera id and loaded scene ids
+void sceneManager::quickSave(const std::string& saveFile){
+    std::ofstream out(sFolder + "/" + saveFile, std::ios::binary);
+    if (!out.is_open()) {
+        throw std::runtime_error("Could not open save file for writing: " + saveFile);
+    }
+    if (!engine->objMgr->writeSnapshot(out)) {
+        throw std::runtime_error("Failed to write snapshot: " + saveFile);
+    }
+
+    int32_t camId = (isCamera && camera) ? camera->id : -1;
+    uint32_t sceneCount = static_cast<uint32_t>(loadedScenes.size());
+    out.write(reinterpret_cast<const char*>(&camId), sizeof(camId));
+    out.write(reinterpret_cast<const char*>(&sceneCount), sizeof(sceneCount));
+    for (auto &p : loadedScenes) {
+        uint32_t nameLen = static_cast<uint32_t>(p.first.size());
+        uint32_t idCount = static_cast<uint32_t>(p.second.size());
+        out.write(reinterpret_cast<const char*>(&nameLen), sizeof(nameLen));
+        out.write(p.first.data(), nameLen);
+        out.write(reinterpret_cast<const char*>(&idCount), sizeof(idCount));
+        out.write(reinterpret_cast<const char*>(p.second.data()), std::streamsize(idCount * sizeof(int)));
+    }
+    if (!out) {
+        throw std::runtime_error("Failed to write save file: " + saveFile);
+    }
+}
+
+void sceneManager::quickLoad(const std::string& saveFile){
+    std::ifstream in(sFolder + "/" + saveFile, std::ios::binary | std::ios::ate);
+    if (!in.is_open()) {
+        throw std::runtime_error("Could not open save file: " + saveFile);
+    }
+    const uint64_t fileSize = static_cast<uint64_t>(in.tellg());
+    in.seekg(0);
+    const uint64_t snapshotBytes = objManager::snapshotExtent(in, fileSize);
+    if (!snapshotBytes) {
+        throw std::runtime_error("Failed to restore snapshot: " + saveFile);
+    }
+
+    // Read the scene state behind the snapshot first, so a bad file is refused
+    // before the world is replaced. Lengths are checked against what is left.
+    in.seekg(std::streamoff(snapshotBytes));
+    uint64_t left = fileSize - snapshotBytes;
+    auto take = [&](void* p, uint64_t n) {
+        if (n > left || !in.read(static_cast<char*>(p), std::streamsize(n))) return false;
+        left -= n;
+        return true;
+    };
+    const std::string missing = "Save file is missing scene state: " + saveFile;
+    int32_t camId = -1;
+    uint32_t sceneCount = 0;
+    if (!take(&camId, sizeof(camId)) || !take(&sceneCount, sizeof(sceneCount))) {
+        throw std::runtime_error(missing);
+    }
+    std::unordered_map<std::string, std::vector<int>> scenes;
+    for (uint32_t i = 0; i < sceneCount; ++i) {
+        uint32_t nameLen = 0, idCount = 0;
+        if (!take(&nameLen, sizeof(nameLen)) || nameLen > left) throw std::runtime_error(missing);
+        std::string name(nameLen, '\0');
+        if (nameLen && !take(&name[0], nameLen)) throw std::runtime_error(missing);
+        if (!take(&idCount, sizeof(idCount)) || idCount > left / sizeof(int)) throw std::runtime_error(missing);
+        std::vector<int> ids(idCount);
+        if (idCount && !take(ids.data(), uint64_t(idCount) * sizeof(int))) throw std::runtime_error(missing);
+        scenes[name] = std::move(ids);
+    }
+
+    in.clear();
+    in.seekg(0);
+    if (!engine->objMgr->readSnapshot(in)) {
+        throw std::runtime_error("Failed to restore snapshot: " + saveFile);
+    }
+
+    // The old camera pointer died with the previous world
+    camera = nullptr;
+    isCamera = false;
+    loadedScenes.swap(scenes);
+
+    if (camId >= 0) {
+        for (auto &p : engine->objMgr->registry) {
+            if (p && p->id == camId) {
+                camera = p.get();
+                isCamera = true;
+                break;
+            }
+        }
+    }
+}
@@ -21,6 +21,11 @@ class sceneManager{
         sceneData unloadScene(const std::string& sceneFile);
         sceneData saveScene(const std::string& sceneName);
 
+        // Binary save-state of the whole object world (quicksave / quickload).
+        // Files live in the scene folder next to the textual scenes.
+        void quickSave(const std::string& saveFile);
+        void quickLoad(const std::string& saveFile);
+
         Object* camera;
         bool isCamera = false;
     private:
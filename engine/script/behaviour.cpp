@@ -0,0 +1,177 @@
+#include "engine/script/behaviour.h"
+#include "engine/obj/obj_mgr.h"
+#include <exception>
+#include <iostream>
+#include <unordered_set>
+
+std::vector<void*> FramePool::freeLists[FramePool::CLASSES];
+size_t FramePool::live = 0;
+
+void* FramePool::allocate(size_t size) {
+    ++live;
+    size_t cls = (size + GRANULE - 1) / GRANULE;
+    if (cls == 0 || cls > CLASSES) return ::operator new(size);
+    auto &fl = freeLists[cls - 1];
+    if (!fl.empty()) {
+        void* p = fl.back();
+        fl.pop_back();
+        return p;
+    }
+    return ::operator new(cls * GRANULE);
+}
+
+void FramePool::release(void* p, size_t size) {
+    --live;
+    size_t cls = (size + GRANULE - 1) / GRANULE;
+    if (cls == 0 || cls > CLASSES) {
+        ::operator delete(p);
+        return;
+    }
+    freeLists[cls - 1].push_back(p);
+}
+
+void FramePool::trim() {
+    for (auto &fl : freeLists) {
+        for (void* p : fl) ::operator delete(p);
+        fl.clear();
+        fl.shrink_to_fit();
+    }
+}
+
+void Behaviour::promise_type::unhandled_exception() {
+    // a throwing behaviour finishes early; the engine keeps running
+    try {
+        throw;
+    } catch (const std::exception& e) {
+        std::cerr << "Behaviour: unhandled exception: " << e.what() << "\n";
+    } catch (...) {
+        std::cerr << "Behaviour: unhandled exception\n";
+    }
+}
+
+BehaviourRunner::~BehaviourRunner() {
+    for (uint32_t i = 0; i < entries.size(); ++i) {
+        if (entries[i].root) destroy(i);
+    }
+    FramePool::trim();
+}
+
+BehaviourRunner::BehaviourId BehaviourRunner::start(Behaviour b, const Object* owner) {
+    Behaviour::Handle h = b.release();
+    if (!h) return 0;
+    if (owner && objMgr && !objMgr->findById(owner->id)) {
+        h.destroy();
+        return 0;
+    }
+
+    uint32_t i;
+    if (!freeEntries.empty()) {
+        i = freeEntries.back();
+        freeEntries.pop_back();
+    } else {
+        i = uint32_t(entries.size());
+        entries.emplace_back();
+    }
+    Entry &e = entries[i];
+    e.root = h;
+    e.resumeAt = h;
+    e.owner = owner ? owner->id : 0;
+    h.promise().runner = this;
+    h.promise().entry = i;
+    ready.push_back(Ticket{i, e.generation});
+    ++live;
+    return (BehaviourId(e.generation) << 32) | i;
+}
+
+bool BehaviourRunner::running(BehaviourId id) const {
+    uint32_t i = uint32_t(id);
+    return i < entries.size() && entries[i].root && entries[i].generation == uint32_t(id >> 32);
+}
+
+void BehaviourRunner::stop(BehaviourId id) {
+    if (!running(id)) return;
+    uint32_t i = uint32_t(id);
+    if (entries[i].running) entries[i].stopping = true; // destroyed once it suspends
+    else destroy(i);
+}
+
+void BehaviourRunner::stopOwners(const std::vector<int>& ownerIds) {
+    if (live == 0 || ownerIds.empty()) return;
+    std::unordered_set<int> doomed(ownerIds.begin(), ownerIds.end());
+    for (uint32_t i = 0; i < entries.size(); ++i) {
+        const Entry &e = entries[i];
+        if (e.root && e.owner && doomed.count(e.owner)) stop((BehaviourId(e.generation) << 32) | i);
+    }
+}
+
+void BehaviourRunner::destroy(uint32_t i) {
+    Entry &e = entries[i];
+    if (e.timer && timers) timers->cancel(e.timer);
+    if (e.sub && events) events->unsubscribe(e.sub);
+    Behaviour::Handle root = e.root;
+    uint32_t gen = e.generation + 1; // invalidates ids and queued tickets
+    e = Entry();
+    e.generation = gen;
+    freeEntries.push_back(i);
+    --live;
+    // frees the whole chain: nested behaviours are owned by their parent's frame
+    root.destroy();
+}
+
+void BehaviourRunner::resume(uint32_t i) {
+    {
+        Entry &e = entries[i];
+        if (e.owner && objMgr && !objMgr->findById(e.owner)) {
+            destroy(i);
+            return;
+        }
+        e.running = true;
+        std::coroutine_handle<> h = std::exchange(e.resumeAt, nullptr);
+        h.resume();
+    }
+    // the behaviour may have started others, so `entries` can have grown
+    Entry &e = entries[i];
+    e.running = false;
+    if (e.stopping || e.root.done()) destroy(i);
+}
+
+void BehaviourRunner::wake(uint32_t i, uint32_t generation) {
+    if (i >= entries.size() || !entries[i].root || entries[i].generation != generation) return;
+    ready.push_back(Ticket{i, generation});
+}
+
+void BehaviourRunner::waitFrame(uint32_t i, std::coroutine_handle<> h) {
+    entries[i].resumeAt = h;
+    nextFrame.push_back(Ticket{i, entries[i].generation});
+}
+
+void BehaviourRunner::waitTimer(uint32_t i, std::coroutine_handle<> h, float secs) {
+    Entry &e = entries[i];
+    e.resumeAt = h;
+    if (!timers) {
+        nextFrame.push_back(Ticket{i, e.generation});
+        return;
+    }
+    uint32_t gen = e.generation;
+    e.timer = timers->after(secs, [this, i, gen]{
+        if (i < entries.size() && entries[i].generation == gen) entries[i].timer = 0;
+        wake(i, gen);
+    });
+}
+
+void BehaviourRunner::run() {
+    // due now: new behaviours, fired timers, delivered events and last frame's nextFrame()
+    // waiters. Anything that suspends again during this run waits for the next one.
+    resuming.clear();
+    resuming.swap(ready);
+    resuming.insert(resuming.end(), nextFrame.begin(), nextFrame.end());
+    nextFrame.clear();
+
+    for (const Ticket &t : resuming) {
+        if (t.entry >= entries.size()) continue;
+        const Entry &e = entries[t.entry];
+        if (!e.root || e.generation != t.generation || !e.resumeAt) continue;
+        resume(t.entry);
+    }
+    resuming.clear();
+}
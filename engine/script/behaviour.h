@@ -0,0 +1,227 @@
+#ifndef BEHAVIOUR_H
+#define BEHAVIOUR_H
+
+#include <coroutine>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <utility>
+#include <vector>
+
+#include "engine/event/event_bus.h"
+#include "engine/timer/timer_service.h"
+
+class Object;
+class objManager;
+class BehaviourRunner;
+
+// Coroutine-based object behaviours.
+//
+// A behaviour is a function returning `Behaviour` that can suspend on:
+//   co_await nextFrame();               resume on the next engine update
+//   co_await seconds(2.0f);             resume once an engine timer fires
+//   E ev = co_await event<E>(target);   resume on the next E addressed to target
+//                                       (any E when target is null)
+//   co_await otherBehaviour(...);       run a nested behaviour to completion
+//
+// Suspended behaviours are parked on the timer wheel / event bus and cost nothing
+// per frame. Coroutine frames come from a size-class pool, so starting and finishing
+// behaviours doesn't hit the heap once the pool is warm.
+//
+//   Behaviour patrol(Object* self) {
+//       for (;;) {
+//           self->lx += 1.0f;
+//           co_await seconds(1.0f);
+//           Damage hit = co_await event<Damage>(self);
+//       }
+//   }
+//   engine->behaviours->start(patrol(bob), bob); // stopped when bob is destroyed
+
+// Free-list pool for coroutine frames, bucketed by 64-byte size class (engine thread only)
+class FramePool {
+public:
+    static void* allocate(size_t size);
+    static void release(void* p, size_t size);
+    static size_t liveFrames() { return live; }
+    static void trim(); // return pooled (unused) frames to the heap
+
+private:
+    static const size_t GRANULE = 64;
+    static const size_t CLASSES = 32; // frames up to 2 KB are pooled
+    static std::vector<void*> freeLists[CLASSES];
+    static size_t live;
+};
+
+class Behaviour {
+public:
+    struct promise_type {
+        BehaviourRunner* runner = nullptr;
+        uint32_t entry = 0;                 // runner slot of the top-level behaviour
+        std::coroutine_handle<> continuation; // parent when awaited as a nested behaviour
+
+        Behaviour get_return_object() {
+            return Behaviour(std::coroutine_handle<promise_type>::from_promise(*this));
+        }
+        std::suspend_always initial_suspend() noexcept { return {}; }
+
+        struct FinalAwaiter {
+            bool await_ready() noexcept { return false; }
+            std::coroutine_handle<> await_suspend(std::coroutine_handle<promise_type> h) noexcept {
+                auto parent = h.promise().continuation;
+                return parent ? parent : std::noop_coroutine();
+            }
+            void await_resume() noexcept {}
+        };
+        FinalAwaiter final_suspend() noexcept { return {}; }
+
+        void return_void() {}
+        void unhandled_exception();
+
+        static void* operator new(size_t size) { return FramePool::allocate(size); }
+        static void operator delete(void* p, size_t size) { FramePool::release(p, size); }
+    };
+    using Handle = std::coroutine_handle<promise_type>;
+
+    Behaviour() = default;
+    explicit Behaviour(Handle h) : handle(h) {}
+    Behaviour(Behaviour&& o) noexcept : handle(std::exchange(o.handle, nullptr)) {}
+    Behaviour& operator=(Behaviour&& o) noexcept {
+        if (this != &o) { reset(); handle = std::exchange(o.handle, nullptr); }
+        return *this;
+    }
+    Behaviour(const Behaviour&) = delete;
+    Behaviour& operator=(const Behaviour&) = delete;
+    ~Behaviour() { reset(); }
+
+    bool valid() const { return bool(handle); }
+
+    // Awaiting a behaviour runs it inside the caller's slot and resumes the caller when done
+    bool await_ready() const noexcept { return !handle || handle.done(); }
+    std::coroutine_handle<> await_suspend(Handle parent) noexcept {
+        handle.promise().runner = parent.promise().runner;
+        handle.promise().entry = parent.promise().entry;
+        handle.promise().continuation = parent;
+        return handle;
+    }
+    void await_resume() noexcept {}
+
+private:
+    friend class BehaviourRunner;
+    Handle release() { return std::exchange(handle, nullptr); }
+    void reset() { if (handle) { handle.destroy(); handle = nullptr; } }
+
+    Handle handle = nullptr;
+};
+
+// Owns running behaviours and resumes them from Engine::update
+class BehaviourRunner {
+public:
+    using BehaviourId = uint64_t; // (generation << 32) | slot; 0 is never issued
+
+    BehaviourRunner(objManager* mgr, TimerService* timers, EventBus* events)
+        : objMgr(mgr), timers(timers), events(events) {}
+    ~BehaviourRunner();
+
+    // Start a behaviour; it runs up to its first suspension during the next run().
+    // With an owner it is stopped (and never resumed) once the owner is destroyed.
+    BehaviourId start(Behaviour b, const Object* owner = nullptr);
+    void stop(BehaviourId id);
+    bool running(BehaviourId id) const;
+    void stopOwners(const std::vector<int>& ownerIds);
+    size_t count() const { return live; }
+
+    // Resume every behaviour that is due (new, next-frame, fired timers, delivered events)
+    void run();
+
+    // --- used by the awaiters below
+    void waitFrame(uint32_t entry, std::coroutine_handle<> h);
+    void waitTimer(uint32_t entry, std::coroutine_handle<> h, float secs);
+    template <typename E>
+    void waitEvent(uint32_t entry, std::coroutine_handle<> h, int target, std::optional<E>* out);
+
+private:
+    struct Entry {
+        Behaviour::Handle root = nullptr;
+        std::coroutine_handle<> resumeAt = nullptr; // suspended leaf (root or a nested behaviour)
+        uint32_t generation = 1;
+        int owner = 0;
+        TimerService::TimerId timer = 0;
+        EventBus::HandlerId sub = 0;
+        bool running = false;   // currently being resumed
+        bool stopping = false;  // stop() requested while running
+    };
+    struct Ticket { uint32_t entry; uint32_t generation; };
+
+    void wake(uint32_t entry, uint32_t generation);
+    void destroy(uint32_t entry);
+    void resume(uint32_t entry);
+
+    objManager* objMgr = nullptr;
+    TimerService* timers = nullptr;
+    EventBus* events = nullptr;
+
+    std::vector<Entry> entries;
+    std::vector<uint32_t> freeEntries;
+    std::vector<Ticket> ready;     // resumed by the next run()
+    std::vector<Ticket> nextFrame; // resumed by the run() after that
+    std::vector<Ticket> resuming;  // scratch for run()
+    size_t live = 0;
+};
+
+template <typename E>
+void BehaviourRunner::waitEvent(uint32_t entry, std::coroutine_handle<> h, int target, std::optional<E>* out) {
+    Entry &e = entries[entry];
+    e.resumeAt = h;
+    if (!events) return;
+    uint32_t gen = e.generation;
+    auto fn = [this, entry, gen, out](const E& ev, Object*) {
+        if (out->has_value()) return;
+        out->emplace(ev);
+        events->unsubscribe(entries[entry].sub);
+        entries[entry].sub = 0;
+        wake(entry, gen);
+    };
+    e.sub = target ? events->subscribeObject<E>(target, fn) : events->subscribe<E>(fn);
+}
+
+// -----------------------------
+// awaitables
+
+struct NextFrameAwaiter {
+    bool await_ready() const noexcept { return false; }
+    void await_suspend(Behaviour::Handle h) {
+        h.promise().runner->waitFrame(h.promise().entry, h);
+    }
+    void await_resume() const noexcept {}
+};
+
+struct SecondsAwaiter {
+    float secs;
+    bool await_ready() const noexcept { return false; }
+    void await_suspend(Behaviour::Handle h) {
+        h.promise().runner->waitTimer(h.promise().entry, h, secs);
+    }
+    void await_resume() const noexcept {}
+};
+
+template <typename E>
+struct EventAwaiter {
+    int target = 0;
+    std::optional<E> value;
+    bool await_ready() const noexcept { return false; }
+    void await_suspend(Behaviour::Handle h) {
+        h.promise().runner->waitEvent<E>(h.promise().entry, h, target, &value);
+    }
+    E await_resume() { return std::move(*value); }
+};
+
+inline NextFrameAwaiter nextFrame() { return {}; }
+inline SecondsAwaiter seconds(float secs) { return SecondsAwaiter{secs}; }
+template <typename E>
+EventAwaiter<E> event(const Object* target = nullptr) {
+    EventAwaiter<E> a;
+    a.target = target ? target->id : 0;
+    return a;
+}
+
+#endif // BEHAVIOUR_H
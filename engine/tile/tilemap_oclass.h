@@ -0,0 +1,266 @@
+#ifndef TILEMAP_OCLASS_H
+#define TILEMAP_OCLASS_H
+
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+#include <sstream>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+
+#include "engine/obj/obj.h"
+#include "engine/obj/obj_factory.h"
+#include "engine/obj/obj_mgr.h"
+
+// Dense grid of ground tiles stored as compact ids instead of one Tile_OBJ per tile.
+// Tile ids index the map's palette of `tile.*` subclasses (0 = empty cell), and the
+// grid is split into CHUNK x CHUNK blocks that are only allocated once they hold a
+// tile, so a 1024x1024 map costs ~2 MB.
+//
+// Scene usage (properties are applied in order, so set the size first):
+//   OBJECT ground tilemap 0 0 0
+//   [
+//       width 64;
+//       height 64;
+//       fill "grass";
+//       row "3 grass*10 half_grass . grass";   // y, then names; name*N repeats, "." is empty
+//       tile "5 7 half_grass";                 // x y name
+//   ];
+class TileMap_OBJ : public Object {
+public:
+    static const int CHUNK = 32;
+    static const int MAX_SIDE = 16384; // largest width/height (scene properties and snapshots)
+    using TileId = uint16_t;
+
+    TileMap_OBJ() {
+        obj_class = "tilemap";
+        registerProperty("width", [this](const Json::Value &v){ if (!v.isNull()) resize(v.asInt(), height); });
+        registerProperty("height", [this](const Json::Value &v){ if (!v.isNull()) resize(width, v.asInt()); });
+        registerProperty("fill", [this](const Json::Value &v){ if (!v.isNull()) fill(tileIdFor(v.asString())); });
+        registerProperty("row", [this](const Json::Value &v){ if (!v.isNull()) parseRow(v.asString()); });
+        registerProperty("tile", [this](const Json::Value &v){
+            if (v.isNull()) return;
+            std::istringstream iss(v.asString());
+            int tx = 0, ty = 0;
+            std::string name;
+            if (iss >> tx >> ty >> name) setTile(tx, ty, tileIdFor(name));
+        });
+    }
+
+    int getWidth() const { return width; }
+    int getHeight() const { return height; }
+    int chunksX() const { return (width + CHUNK - 1) / CHUNK; }
+    int chunksY() const { return (height + CHUNK - 1) / CHUNK; }
+    // Bumped by every edit (tiles, size, palette) so renderers can tell when to rebuild;
+    // the per-chunk revision only moves when a tile of that chunk changes
+    uint32_t getRevision() const { return revision; }
+    uint32_t getChunkRevision(int cx, int cy) const { return chunkRevisions[size_t(cy) * chunksX() + cx]; }
+
+    // Resize the map, keeping tiles that still fit; each side is clamped to [0, MAX_SIDE]
+    void resize(int w, int h) {
+        if (w > MAX_SIDE || h > MAX_SIDE) {
+            std::cerr << "TileMap_OBJ: size " << w << "x" << h << " clamped to " << MAX_SIDE << "\n";
+        }
+        w = w < 0 ? 0 : (w > MAX_SIDE ? int(MAX_SIDE) : w);
+        h = h < 0 ? 0 : (h > MAX_SIDE ? int(MAX_SIDE) : h);
+        if (w == width && h == height) return;
+        ++revision;
+        std::vector<std::vector<TileId>> oldChunks;
+        oldChunks.swap(chunks);
+        int oldW = width, oldH = height, oldCX = chunksX();
+        width = w; height = h;
+        chunks.assign(size_t(chunksX()) * size_t(chunksY()), std::vector<TileId>());
+        chunkRevisions.assign(chunks.size(), 0);
+        for (size_t i = 0; i < oldChunks.size(); ++i) {
+            const auto &c = oldChunks[i];
+            if (c.empty()) continue;
+            int bx = int(i % oldCX) * CHUNK, by = int(i / oldCX) * CHUNK;
+            for (int ly = 0; ly < CHUNK && by + ly < std::min(height, oldH); ++ly)
+                for (int lx = 0; lx < CHUNK && bx + lx < std::min(width, oldW); ++lx)
+                    if (TileId id = c[ly * CHUNK + lx]) setTile(bx + lx, by + ly, id);
+        }
+    }
+
+    TileId getTile(int tx, int ty) const {
+        if (tx < 0 || ty < 0 || tx >= width || ty >= height) return 0;
+        const auto &c = chunks[size_t(ty / CHUNK) * chunksX() + (tx / CHUNK)];
+        if (c.empty()) return 0;
+        return c[(ty % CHUNK) * CHUNK + (tx % CHUNK)];
+    }
+
+    void setTile(int tx, int ty, TileId id) {
+        if (tx < 0 || ty < 0 || tx >= width || ty >= height) return;
+        size_t ci = size_t(ty / CHUNK) * chunksX() + (tx / CHUNK);
+        auto &c = chunks[ci];
+        if (c.empty()) {
+            if (id == 0) return;
+            c.assign(CHUNK * CHUNK, 0);
+        }
+        TileId &cell = c[(ty % CHUNK) * CHUNK + (tx % CHUNK)];
+        if (cell == id) return;
+        cell = id;
+        ++chunkRevisions[ci];
+        ++revision;
+    }
+
+    void fill(TileId id) {
+        for (int ty = 0; ty < height; ++ty)
+            for (int tx = 0; tx < width; ++tx) setTile(tx, ty, id);
+    }
+
+    // Raw chunk storage (row-major CHUNK*CHUNK ids); empty when the chunk holds no tiles
+    const std::vector<TileId>& getChunk(int cx, int cy) const { return chunks[size_t(cy) * chunksX() + cx]; }
+
+    // Tile at a world position (relative to this map's origin), 0 if none
+    TileId tileAt(float wx, float wy) const {
+        float fx = wx - x, fy = wy - y;
+        if (fx < 0.0f || fy < 0.0f) return 0;
+        return getTile(int(fx), int(fy));
+    }
+
+    // Palette: tile id N maps to palette[N-1], a `tile.*` subclass name
+    const std::vector<std::string>& getPalette() const { return palette; }
+    TileId tileIdFor(const std::string& subclass) {
+        if (subclass.empty() || subclass == ".") return 0;
+        for (size_t i = 0; i < palette.size(); ++i) if (palette[i] == subclass) return TileId(i + 1);
+        if (palette.size() >= 0xFFFF) {
+            std::cerr << "TileMap_OBJ: palette full, ignoring tile." << subclass << "\n";
+            return 0;
+        }
+        palette.push_back(subclass);
+        ++revision;
+        return TileId(palette.size());
+    }
+
+    // Resolved texture path for a tile id (empty for unknown ids or unresolved palette)
+    const std::string& textureFor(TileId id) const {
+        static const std::string none;
+        return (id > 0 && id <= paletteTextures.size()) ? paletteTextures[id - 1] : none;
+    }
+    bool paletteResolved() const { return paletteTextures.size() == palette.size(); }
+
+    // Resolve palette entries to texture paths via the tile.* prototypes. Entries may
+    // be added by scene properties after instantiation, so this is re-run when needed.
+    void resolvePalette(const objManager& mgr) {
+        for (size_t i = paletteTextures.size(); i < palette.size(); ++i) {
+            std::string tex;
+            if (!mgr.findPrototypeTexture("tile", palette[i], "default", tex)) {
+                std::cerr << "TileMap_OBJ: unknown tile prototype tile." << palette[i] << "\n";
+            }
+            paletteTextures.push_back(tex);
+            ++revision;
+        }
+    }
+
+    // The map itself has no sprite; only its palette is resolved
+    void resolveTexture(const objManager& mgr) override {
+        texture.clear();
+        resolvePalette(mgr);
+    }
+
+    // Snapshot state: size, palette names and allocated chunks
+    void saveState(std::vector<unsigned char>& out) const override {
+        auto put = [&](const void* p, size_t n){ const unsigned char* b = static_cast<const unsigned char*>(p); out.insert(out.end(), b, b + n); };
+        int32_t dims[2] = {width, height};
+        uint32_t pc = uint32_t(palette.size());
+        put(dims, sizeof(dims));
+        put(&pc, sizeof(pc));
+        for (const auto &name : palette) {
+            uint32_t len = uint32_t(name.size());
+            put(&len, sizeof(len));
+            put(name.data(), len);
+        }
+        for (const auto &c : chunks) {
+            unsigned char present = c.empty() ? 0 : 1;
+            put(&present, 1);
+            if (present) put(c.data(), c.size() * sizeof(TileId));
+        }
+    }
+
+    // The blob comes from a snapshot file: everything is parsed into locals and checked
+    // before the map is touched, so a bad or truncated blob leaves it as it was
+    void loadState(const unsigned char* data, size_t size) override {
+        size_t off = 0;
+        auto get = [&](void* p, size_t n){ if (off + n > size) return false; memcpy(p, data + off, n); off += n; return true; };
+        auto reject = [](const char* why){ std::cerr << "TileMap_OBJ: ignoring snapshot state (" << why << ")\n"; };
+        int32_t dims[2] = {0, 0};
+        uint32_t pc = 0;
+        if (!get(dims, sizeof(dims)) || !get(&pc, sizeof(pc))) return reject("truncated");
+        if (dims[0] < 0 || dims[1] < 0 || dims[0] > MAX_SIDE || dims[1] > MAX_SIDE) return reject("bad size");
+        if (pc > 0xFFFF) return reject("bad palette");
+        std::vector<std::string> newPalette;
+        newPalette.reserve(pc);
+        for (uint32_t i = 0; i < pc; ++i) {
+            uint32_t len = 0;
+            if (!get(&len, sizeof(len)) || len > size - off) return reject("truncated");
+            newPalette.emplace_back(reinterpret_cast<const char*>(data + off), len);
+            off += len;
+        }
+        size_t chunkCount = size_t((dims[0] + CHUNK - 1) / CHUNK) * size_t((dims[1] + CHUNK - 1) / CHUNK);
+        if (chunkCount > size - off) return reject("truncated"); // at least a presence byte each
+        std::vector<std::vector<TileId>> newChunks(chunkCount);
+        for (auto &c : newChunks) {
+            unsigned char present = 0;
+            if (!get(&present, 1)) return reject("truncated");
+            if (!present) continue;
+            c.resize(CHUNK * CHUNK);
+            if (!get(c.data(), c.size() * sizeof(TileId))) return reject("truncated");
+        }
+
+        ++revision;
+        width = dims[0]; height = dims[1];
+        palette.swap(newPalette);
+        paletteTextures.clear();
+        chunks.swap(newChunks);
+        chunkRevisions.assign(chunks.size(), 0);
+    }
+
+private:
+    int width = 0;
+    int height = 0;
+    uint32_t revision = 0;
+    std::vector<std::string> palette;
+    std::vector<std::string> paletteTextures;
+    std::vector<std::vector<TileId>> chunks;
+    std::vector<uint32_t> chunkRevisions; // parallel to chunks
+
+    // "y name name*N . name"
+    void parseRow(const std::string& spec) {
+        std::istringstream iss(spec);
+        int ty = 0;
+        if (!(iss >> ty)) return;
+        int tx = 0;
+        std::string tok;
+        while (iss >> tok) {
+            int repeat = 1;
+            auto star = tok.find('*');
+            if (star != std::string::npos) {
+                try { repeat = std::stoi(tok.substr(star + 1)); } catch (...) { repeat = 1; }
+                if (repeat > MAX_SIDE) repeat = MAX_SIDE; // the row ends at width anyway
+                tok = tok.substr(0, star);
+            }
+            TileId id = tileIdFor(tok);
+            for (int i = 0; i < repeat && tx < width; ++i) setTile(tx++, ty, id);
+        }
+    }
+};
+
+// -----------------------------
+// Register the object type
+// This must be AFTER the full class definition
+namespace {
+    struct TileMap_OBJ_Registrar {
+        TileMap_OBJ_Registrar() {
+            ObjectFactory::registerClass("tilemap", []() -> std::unique_ptr<Object> {
+                return std::make_unique<TileMap_OBJ>();
+            });
+        }
+    };
+
+    // Static instance triggers registration at startup
+    static TileMap_OBJ_Registrar global_TileMap_OBJ_registrar;
+}
+
+#endif // TILEMAP_OCLASS_H
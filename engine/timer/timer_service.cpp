@@ -0,0 +1,181 @@
+#include "engine/timer/timer_service.h"
+#include "engine/obj/obj_mgr.h"
+#include <cmath>
+
+TimerService::TimerService(objManager* mgr, double tickSeconds)
+    : objMgr(mgr), tick(tickSeconds > 0.0 ? tickSeconds : 0.001) {
+    for (auto &h : heads) h = -1;
+}
+
+uint64_t TimerService::toTicks(float seconds) const {
+    double t = std::round(double(seconds) / tick); // nearest tick: 0.1f must not become 101 ms
+    if (!(t >= 1.0)) return 1; // also catches NaN
+    if (t >= double(MAX_DELAY)) return MAX_DELAY;
+    return uint64_t(t);
+}
+
+TimerService::TimerId TimerService::after(float seconds, Callback fn, const Object* owner) {
+    return schedule(seconds, 0, std::move(fn), owner);
+}
+
+TimerService::TimerId TimerService::every(float seconds, Callback fn, const Object* owner) {
+    return schedule(seconds, toTicks(seconds), std::move(fn), owner);
+}
+
+TimerService::TimerId TimerService::schedule(float seconds, uint64_t interval, Callback&& fn, const Object* owner) {
+    if (!fn) return 0;
+    if (owner && objMgr && !objMgr->findById(owner->id)) return 0;
+
+    int32_t i;
+    if (!freeNodes.empty()) {
+        i = freeNodes.back();
+        freeNodes.pop_back();
+    } else {
+        i = int32_t(nodes.size());
+        nodes.emplace_back();
+    }
+    Node &n = nodes[i];
+    n.fn = std::move(fn);
+    n.due = current + toTicks(seconds);
+    n.interval = interval;
+    n.owner = owner ? owner->id : 0;
+    n.used = true;
+    link(i);
+
+    if (n.owner) {
+        auto it = ownerHeads.find(n.owner);
+        int32_t head = (it != ownerHeads.end()) ? it->second : -1;
+        n.ownerPrev = -1;
+        n.ownerNext = head;
+        if (head != -1) nodes[head].ownerPrev = i;
+        ownerHeads[n.owner] = i;
+    }
+    ++live;
+    return (TimerId(n.generation) << 32) | uint32_t(i);
+}
+
+void TimerService::link(int32_t i) {
+    Node &n = nodes[i];
+    uint64_t delta = n.due > current ? n.due - current : 0;
+    int level = 0;
+    while (level < LEVELS - 1 && delta >= (uint64_t(1) << (SLOT_BITS * (level + 1)))) ++level;
+    int slot = level * SLOTS + int((n.due >> (SLOT_BITS * level)) & (SLOTS - 1));
+
+    n.slot = int16_t(slot);
+    n.prev = -1;
+    n.next = heads[slot];
+    if (n.next != -1) nodes[n.next].prev = i;
+    heads[slot] = i;
+}
+
+void TimerService::unlink(int32_t i) {
+    Node &n = nodes[i];
+    if (n.slot < 0) return;
+    if (n.prev != -1) nodes[n.prev].next = n.next;
+    else heads[n.slot] = n.next;
+    if (n.next != -1) nodes[n.next].prev = n.prev;
+    n.prev = n.next = -1;
+    n.slot = -1;
+}
+
+void TimerService::release(int32_t i) {
+    Node &n = nodes[i];
+    if (!n.used) return;
+    unlink(i);
+    if (n.owner) {
+        if (n.ownerPrev != -1) nodes[n.ownerPrev].ownerNext = n.ownerNext;
+        else if (n.ownerNext != -1) ownerHeads[n.owner] = n.ownerNext;
+        else ownerHeads.erase(n.owner);
+        if (n.ownerNext != -1) nodes[n.ownerNext].ownerPrev = n.ownerPrev;
+    }
+    n.ownerPrev = n.ownerNext = -1;
+    n.owner = 0;
+    n.fn = nullptr;
+    n.used = false;
+    ++n.generation; // invalidates outstanding ids
+    freeNodes.push_back(i);
+    --live;
+}
+
+bool TimerService::active(TimerId id) const {
+    uint32_t i = uint32_t(id);
+    return i < nodes.size() && nodes[i].used && nodes[i].generation == uint32_t(id >> 32);
+}
+
+bool TimerService::cancel(TimerId id) {
+    if (!active(id)) return false;
+    release(int32_t(uint32_t(id)));
+    return true;
+}
+
+void TimerService::cancelOwner(int ownerId) {
+    auto it = ownerHeads.find(ownerId);
+    while (it != ownerHeads.end()) {
+        release(it->second); // moves the head along or erases the entry
+        it = ownerHeads.find(ownerId);
+    }
+}
+
+void TimerService::cancelOwners(const std::vector<int>& ownerIds) {
+    if (ownerHeads.empty()) return;
+    for (int id : ownerIds) cancelOwner(id);
+}
+
+void TimerService::clear() {
+    for (int32_t i = 0; i < int32_t(nodes.size()); ++i) release(i);
+}
+
+void TimerService::cascade(int level) {
+    int slot = level * SLOTS + int((current >> (SLOT_BITS * level)) & (SLOTS - 1));
+    // every timer here is due within this slot's span, so link() files it on a finer wheel
+    while (heads[slot] != -1) {
+        int32_t i = heads[slot];
+        unlink(i);
+        link(i);
+    }
+}
+
+void TimerService::fire(int slot) {
+    while (heads[slot] != -1) {
+        int32_t i = heads[slot];
+        Node &n = nodes[i];
+        if (n.owner && objMgr && !objMgr->findById(n.owner)) {
+            release(i);
+            continue;
+        }
+        // take the callback out first: it may cancel this timer or schedule new ones
+        // (which can grow `nodes`), so the node is only touched again by index
+        uint32_t gen = n.generation;
+        Callback fn = std::move(n.fn);
+        if (n.interval) {
+            unlink(i);
+            n.due = current + n.interval;
+            link(i);
+        } else {
+            release(i);
+        }
+        fn();
+        if (nodes[i].used && nodes[i].generation == gen) nodes[i].fn = std::move(fn);
+    }
+}
+
+void TimerService::advance(float dt) {
+    if (dt > 0.0f) pendingTicks += double(dt) / tick;
+    if (live == 0) {
+        // nothing scheduled: jump the clock instead of walking empty slots
+        double whole = std::floor(pendingTicks);
+        current += uint64_t(whole);
+        pendingTicks -= whole;
+        return;
+    }
+    while (pendingTicks >= 1.0) {
+        pendingTicks -= 1.0;
+        ++current;
+        // when a wheel wraps, pull the next slot of the coarser wheel down
+        for (int level = 1; level < LEVELS; ++level) {
+            if ((current & ((uint64_t(1) << (SLOT_BITS * level)) - 1)) != 0) break;
+            cascade(level);
+        }
+        fire(int(current & (SLOTS - 1)));
+    }
+}
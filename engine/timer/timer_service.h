@@ -0,0 +1,91 @@
+#ifndef TIMER_SERVICE_H
+#define TIMER_SERVICE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <unordered_map>
+#include <vector>
+
+class Object;
+class objManager;
+
+// Engine timers on a hierarchical timing wheel.
+//
+// Time advances in fixed ticks (1 ms by default). Timers live in one of four wheels
+// of 256 slots each (1 tick, 256 ticks, 65536 ticks, 16.7M ticks per slot) and only
+// move to a finer wheel when their coarse slot comes up, so scheduling, cancelling
+// and idle timers are O(1) and a frame only touches the slots it passes over.
+//
+// A timer may be bound to an owner object: it never fires once the owner is gone and
+// is released when the engine reports the owner destroyed.
+//
+//   auto id = engine->timers->after(2.0f, [bob]{ bob->setInvis(true); }, bob);
+//   engine->timers->every(1.0f, []{ std::cout << "tick\n"; });
+//   engine->timers->cancel(id);
+class TimerService {
+public:
+    using TimerId = uint64_t; // (generation << 32) | node index; 0 is never issued
+    using Callback = std::function<void()>;
+
+    explicit TimerService(objManager* mgr, double tickSeconds = 0.001);
+
+    // One-shot timer firing `seconds` from now (at least one tick)
+    TimerId after(float seconds, Callback fn, const Object* owner = nullptr);
+    // Repeating timer firing every `seconds` until cancelled
+    TimerId every(float seconds, Callback fn, const Object* owner = nullptr);
+
+    // Safe to call from inside a callback (including the timer's own)
+    bool cancel(TimerId id);
+    bool active(TimerId id) const;
+    void cancelOwner(int ownerId);
+    void cancelOwners(const std::vector<int>& ownerIds);
+    void clear();
+
+    // Advance the clock by dt seconds, firing everything that comes due
+    void advance(float dt);
+
+    double now() const { return double(current) * tick; } // seconds since the service started
+    size_t activeCount() const { return live; }
+
+private:
+    static const int LEVELS = 4;
+    static const int SLOT_BITS = 8;
+    static const int SLOTS = 1 << SLOT_BITS;
+    // furthest schedulable delay: beyond this the top wheel would wrap onto its current slot
+    static const uint64_t MAX_DELAY = (uint64_t(1) << (LEVELS * SLOT_BITS)) - (uint64_t(1) << ((LEVELS - 1) * SLOT_BITS));
+
+    struct Node {
+        Callback fn;
+        uint64_t due = 0;      // absolute tick
+        uint64_t interval = 0; // ticks, 0 = one-shot
+        uint32_t generation = 1;
+        int owner = 0;
+        int32_t prev = -1, next = -1;           // slot list
+        int32_t ownerPrev = -1, ownerNext = -1; // owner list
+        int16_t slot = -1;                      // flat wheel slot, -1 = not scheduled
+        bool used = false;
+    };
+
+    TimerId schedule(float seconds, uint64_t interval, Callback&& fn, const Object* owner);
+    uint64_t toTicks(float seconds) const;
+
+    void link(int32_t i);       // place in the wheel slot for its due tick
+    void unlink(int32_t i);
+    void release(int32_t i);    // unlink from everything and recycle
+    void cascade(int level);    // move a coarse slot's timers down a level
+    void fire(int slot);
+
+    objManager* objMgr = nullptr;
+    double tick = 0.001;
+    double pendingTicks = 0.0;  // fractional ticks carried between frames
+    uint64_t current = 0;       // last processed tick
+
+    std::vector<Node> nodes;
+    std::vector<int32_t> freeNodes;
+    int32_t heads[LEVELS * SLOTS];
+    std::unordered_map<int, int32_t> ownerHeads;
+    size_t live = 0;
+};
+
+#endif // TIMER_SERVICE_H
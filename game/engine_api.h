@@ -41,6 +41,60 @@ static inline sceneData unloadScene(
     return engine->sceneMgr->unloadScene(sceneFile);
 }
 
+// Binary save-state of every live object (file is placed in the scene folder)
+static inline void quickSave(const std::string& saveFile) {
+    if (!engine || !engine->sceneMgr) return;
+    engine->sceneMgr->quickSave(saveFile);
+}
+static inline void quickLoad(const std::string& saveFile) {
+    if (!engine || !engine->sceneMgr) return;
+    engine->sceneMgr->quickLoad(saveFile);
+}
+
+// Spatial queries over world objects (tile coordinates / world units)
+static inline std::vector<Object*> ObjectsAtTile(int tx, int ty) {
+    std::vector<Object*> out;
+    if (engine && engine->objMgr) engine->objMgr->grid.queryCell(tx, ty, out);
+    return out;
+}
+static inline std::vector<Object*> ObjectsInRect(float x0, float y0, float x1, float y1) {
+    std::vector<Object*> out;
+    if (engine && engine->objMgr) engine->objMgr->grid.queryRect(x0, y0, x1, y1, out);
+    return out;
+}
+static inline std::vector<Object*> ObjectsInRadius(float x, float y, float radius) {
+    std::vector<Object*> out;
+    if (engine && engine->objMgr) engine->objMgr->grid.queryRadius(x, y, radius, out);
+    return out;
+}
+
+// Engine timers. Passing an owner cancels the timer when that object is destroyed.
+static inline TimerService::TimerId After(float seconds, TimerService::Callback fn, const Object* owner = nullptr) {
+    if (!engine || !engine->timers) return 0;
+    return engine->timers->after(seconds, std::move(fn), owner);
+}
+static inline TimerService::TimerId Every(float seconds, TimerService::Callback fn, const Object* owner = nullptr) {
+    if (!engine || !engine->timers) return 0;
+    return engine->timers->every(seconds, std::move(fn), owner);
+}
+static inline bool CancelTimer(TimerService::TimerId id) {
+    if (!engine || !engine->timers) return false;
+    return engine->timers->cancel(id);
+}
+
+// Run a coroutine behaviour (see engine/script/behaviour.h); with an owner it stops when that object is destroyed
+static inline BehaviourRunner::BehaviourId StartBehaviour(Behaviour b, const Object* owner = nullptr) {
+    if (!engine || !engine->behaviours) return 0;
+    return engine->behaviours->start(std::move(b), owner);
+}
+
+// Topmost world sprite under a window-space point such as a mouse click.
+// Transparent pixels of a sprite don't count; tile hits report the cell in tileX/tileY.
+static inline PickResult PickAt(int x, int y) {
+    if (!engine || !engine->rPipeline) return PickResult{};
+    return engine->rPipeline->pick(x, y);
+}
+
 // Add text to the UI layer at normalized device coords (-1..1)
 static inline void UIAddTextAtNDC(const std::string& text, float ndc_x, float ndc_y, const std::string& font = "", int pxSize = 24, bool persistent = false) {
     if (!engine || !engine->rPipeline) return;
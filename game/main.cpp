@@ -33,28 +33,18 @@ int main(int argc, const char *argv[])
   }
 // Demo: create a persistent ui.text object we can update from code
   Object* scoreLabel = InstantiateUIText("Time: 0", -0.9f, -0.8f, "demo/fonts/DMSans.ttf", 24);
-  float elapsed = 0.0f; // seconds since start
-  float display_acc = 0.0f; // accumulator to control update frequency (once per second)
+  int elapsed = 0; // seconds since start
+  // update the label once per second; bound to the label so it stops if the label is removed
+  Every(1.0f, [scoreLabel, &elapsed]{
+    UIText_OBJ* ul = dynamic_cast<UIText_OBJ*>(scoreLabel);
+    if (ul) ul->text = std::string("Time: ") + std::to_string(++elapsed);
+  }, scoreLabel);
 
   engine->objMgr->printTree(engine->objMgr->getRoot());
   while (engine->running())
   {
     engine->handleEvents();
     engine->update();
-
-    // use delta-time to track real elapsed seconds and update label once per second
-    float dt = engine->getDeltaT();
-    elapsed += dt;
-    display_acc += dt;
-
-    if (display_acc >= 1.0f) {
-      display_acc -= 1.0f; // keep residual
-      if (scoreLabel) {
-        UIText_OBJ* ul = dynamic_cast<UIText_OBJ*>(scoreLabel);
-        if (ul) ul->text = std::string("Time: ") + std::to_string(static_cast<int>(elapsed));
-      }
-    }
-
     engine->render();
   }
 
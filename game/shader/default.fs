@@ -2,12 +2,13 @@
 out vec4 FragColor;
 
 in vec3 ourColor;
-in vec2 TexCoord;
+in vec3 TexCoord; // uv, atlas page
+in vec4 Tint;
 
-// texture sampler
-uniform sampler2D texture1;
+// atlas pages (RenderLayer::atlasTex)
+uniform sampler2DArray texture1;
 
 void main()
 {
-	FragColor = texture(texture1, TexCoord);
-}
\ No newline at end of file
+	FragColor = texture(texture1, TexCoord) * Tint;
+}
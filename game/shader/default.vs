@@ -1,14 +1,67 @@
 #version 330 core
+// vertex formats (VertexFormat in render_types.h)
+const int FLOAT_VERTS = 0;
+const int SPRITE_INSTANCES = 1;
+const int QUAD_VERTS = 2;
+
+// FLOAT_VERTS: NDC position, normal, uv. QUAD_VERTS: pixel position (x, y), uv, color
 layout (location = 0) in vec3 aPos;
 layout (location = 1) in vec3 aColor;
 layout (location = 2) in vec2 aTexCoord;
+layout (location = 7) in vec4 aTint;
+layout (location = 8) in uint aPage;
+
+// SPRITE_INSTANCES: one SpriteInstance per sprite
+layout (location = 3) in vec3 iWorld; // world position
+layout (location = 4) in uint iPage;  // atlas page
+layout (location = 5) in vec4 iRect;  // atlas u0 v0 u1 v1
+layout (location = 6) in vec4 iTint;
+layout (location = 9) in vec4 iCrop;  // part of the image kept in the atlas: x0 y0 x1 y1
+
+// isometric view shared by every program that draws world sprites (IsoProjection::Block)
+layout (std140) uniform IsoView {
+	vec4 uProj;   // screen x per (x - y), screen y per (x + y), screen y per z
+	vec4 uCamera; // camera world position
+	vec4 uScreen; // screen offset x/y, virtual width/height
+	vec4 uSprite; // sprite width/height in virtual pixels
+};
+
+uniform int uFormat;
 
 out vec3 ourColor;
-out vec2 TexCoord;
+out vec3 TexCoord; // atlas uv and page (texture array layer)
+out vec4 Tint;
+
+// quad corners; the shared index buffer draws them as 0 1 2, 2 3 0 (renderPipeline::quadTemplate order)
+const vec2 corners[4] = vec2[4](vec2(0, 0), vec2(1, 0), vec2(1, 1), vec2(0, 1));
 
 void main()
 {
-	gl_Position = vec4(aPos, 1.0);
-	ourColor = aColor;
-	TexCoord = vec2(aTexCoord.x, aTexCoord.y);
-}
\ No newline at end of file
+	if (uFormat == SPRITE_INSTANCES) {
+		// same projection and integer snapping as IsoProjection::spriteX/spriteY
+		vec3 o = iWorld - uCamera.xyz;
+		vec2 base = trunc(vec2((o.x - o.y) * uProj.x + uScreen.x,
+		                       (o.x + o.y) * uProj.y - o.z * uProj.z + uScreen.y));
+		vec2 c = corners[gl_VertexID];
+		// quadTemplate maps corner (0,0) to the image's far corner (1,1); a trimmed
+		// image only covers its crop box of the sprite
+		vec2 h = mix(iCrop.zw, iCrop.xy, c);
+		vec2 px = base + (vec2(1.0) - h) * uSprite.xy;
+		// constant depth: painter order comes from draw order (GL_LEQUAL)
+		gl_Position = vec4(2.0 * px.x / uScreen.z - 1.0, 1.0 - 2.0 * px.y / uScreen.w, 0.0, 1.0);
+		ourColor = vec3(0.0, 0.0, 1.0);
+		// quadTemplate maps corner (0,0) to uv (1,1)
+		TexCoord = vec3(mix(iRect.xy, iRect.zw, vec2(1.0) - c), float(iPage));
+		Tint = iTint;
+	} else if (uFormat == QUAD_VERTS) {
+		gl_Position = vec4(2.0 * aPos.x / uScreen.z - 1.0, 1.0 - 2.0 * aPos.y / uScreen.w, 0.0, 1.0);
+		ourColor = vec3(0.0, 0.0, 1.0);
+		TexCoord = vec3(aTexCoord, float(aPage));
+		Tint = aTint;
+	} else {
+		gl_Position = vec4(aPos, 1.0);
+		ourColor = aColor;
+		TexCoord = vec3(aTexCoord.x, aTexCoord.y, 0.0);
+		Tint = vec4(1.0);
+	}
+}